@@ -0,0 +1,438 @@
+/// @filename bench.cpp
+/// @brief Benchmark suite for the priority queue backends.  Build and run with "make bench" for CSV output, or with
+///        "make benchjson" for JSON.  "./bench.exe [--json] [n]" runs every benchmark with n elements (default 100000).
+///
+///        Every result is one row of backend, workload, payload, operation, n, ns/op, allocations/op (calls to the
+///        global operator new) and the peak resident set size of the process so far in KiB.
+///        Workloads are the priority sequences fed to the queue:
+///          ascending, descending - sorted priorities, the worst case for an unbalanced BST
+///          random                - uniformly random priorities
+///          duplicates            - random priorities from only 16 distinct values, so duplicate lists are long
+///          sawtooth              - runs of 1000 ascending priorities
+///          hold                  - a queue of random priorities held at a steady size while dequeue and enqueue
+///                                  alternate, the classic event simulation pattern
+///        Payloads are int, string (long enough to be heap allocated) and large (a 128 byte struct).
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "priorityqueue.h"
+#include "heappriorityqueue.h"
+#include "mappedpriorityqueue.h"
+#include "compactpriorityqueue.h"
+using namespace std;
+
+long allocations = 0;  // # of calls to the global operator new
+
+void* operator new(size_t bytes){
+    allocations++;
+    if (void* memory = malloc(bytes))
+        return memory;
+    throw bad_alloc();
+}
+
+//GCC cannot see that the replacement operator new above gets its memory from malloc once both are inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+#pragma GCC diagnostic pop
+
+struct RESULT {
+    string backend;  // queue implementation measured
+    string workload;  // priority sequence, see the file comment
+    string payload;  // value type
+    string operation;  // operation timed
+    int n;  // # of elements in the queue
+    double nsPerOp;  // average time per operation
+    double allocationsPerOp;  // average calls to operator new per operation
+    long peakRssKiB;  // peak resident set size of the process after the operation
+};
+vector<RESULT> results;  // every measurement in the order it was taken
+long sink = 0;  // folds in results so the optimizer cannot drop the work being timed
+
+struct LARGE {
+    array<long long, 16> data;  // 128 bytes copied with every value
+
+    bool operator==(const LARGE& other) const {
+        return data == other.data;
+    }
+
+    friend ostream& operator<<(ostream& out, const LARGE& large) {
+        return out << large.data[0];
+    }
+};
+
+/// @brief Build the payload value for element i
+/// @param i index of the element
+/// @return value of the given payload type
+template<typename T>
+T MakeValue(int i);
+
+template<>
+int MakeValue<int>(int i){
+    return i;
+}
+
+template<>
+string MakeValue<string>(int i){
+    return "payload string for element " + to_string(i);
+}
+
+template<>
+LARGE MakeValue<LARGE>(int i){
+    LARGE value;
+    value.data.fill(i);
+    return value;
+}
+
+/// @brief Reduce a payload value to a number that can be folded into the sink
+/// @param value value to reduce
+/// @return a number that depends on the value
+long Consume(int value){
+    return value;
+}
+
+long Consume(const string& value){
+    return value.size();
+}
+
+long Consume(const LARGE& value){
+    return value.data[0];
+}
+
+/// @brief Return the peak resident set size of the process so far
+/// @return peak resident set size in KiB
+long PeakRssKiB(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/// @brief Time a piece of work and record its time and allocations per operation
+/// @param backend queue implementation measured
+/// @param workload priority sequence used
+/// @param payload value type used
+/// @param operation name of the operation timed
+/// @param n # of elements in the queue
+/// @param ops # of operations the work performs
+/// @param work the work to time
+void Measure(const string& backend, const string& workload, const string& payload, const string& operation, int n,
+             long ops, const function<void()>& work){
+    long allocationsBefore = allocations;
+    auto start = chrono::steady_clock::now();
+    work();
+    auto end = chrono::steady_clock::now();
+
+    results.push_back({backend, workload, payload, operation, n,
+                       chrono::duration<double, nano>(end - start).count() / ops,
+                       double(allocations - allocationsBefore) / ops, PeakRssKiB()});
+}
+
+/// @brief Step a linear congruential generator, the same sequence on every platform
+/// @param seed generator state, updated
+/// @return next random number
+unsigned int Random(unsigned int& seed){
+    seed = seed * 1103515245 + 12345;
+    return seed >> 1;
+}
+
+/// @brief Generate the priority sequence of a workload
+/// @param workload name of the workload, see the file comment
+/// @param n number of priorities
+/// @return the priorities in enqueue order
+vector<int> Priorities(const string& workload, int n){
+    vector<int> priorities(n);
+    unsigned int seed = 12345;
+
+    for (int i = 0; i < n; i++){
+        if (workload == "ascending")
+            priorities[i] = i;
+        else if (workload == "descending")
+            priorities[i] = n - i;
+        else if (workload == "duplicates")
+            priorities[i] = Random(seed) % 16;
+        else if (workload == "sawtooth")
+            priorities[i] = i % 1000;
+        else
+            priorities[i] = Random(seed) % 1000000000;
+    }
+    return priorities;
+}
+
+/// @brief Run every operation a backend supports on one workload and payload.  The tree backend also times
+///        begin/next, operator=, operator== and toString, which the heap backends do not have
+/// @param backend name of the queue implementation
+/// @param workload name of the workload, see the file comment
+/// @param payload name of the value type
+/// @param n number of elements
+template<typename QUEUE, typename T>
+void RunWorkload(const string& backend, const string& workload, const string& payload, int n){
+    constexpr bool tree = is_same<QUEUE, priorityqueue<T>>::value || is_same<QUEUE, compactpriorityqueue<T>>::value;
+    vector<int> priorities = Priorities(workload, n);
+    vector<T> values;
+    QUEUE queue;
+
+    values.reserve(n);
+    for (int i = 0; i < n; i++)
+        values.push_back(MakeValue<T>(i));
+
+    if (workload == "hold"){
+        unsigned int seed = 54321;
+        for (int i = 0; i < n; i++)
+            queue.enqueue(values[i], priorities[i]);
+        Measure(backend, workload, payload, "dequeue+enqueue", n, n, [&]{
+            for (int i = 0; i < n; i++)
+                queue.enqueue(queue.dequeue(), Random(seed) % 1000000000);
+        });
+        return;
+    }
+
+    Measure(backend, workload, payload, "enqueue", n, n, [&]{
+        for (int i = 0; i < n; i++)
+            queue.enqueue(values[i], priorities[i]);
+    });
+    Measure(backend, workload, payload, "peek", n, n, [&]{
+        for (int i = 0; i < n; i++)
+            sink += Consume(queue.peek());
+    });
+
+    if constexpr (tree){
+        QUEUE copy;
+        Measure(backend, workload, payload, "begin/next", n, n, [&]{
+            T value{};
+            int priority = 0;
+            queue.begin();
+            bool more = queue.Size() > 0;
+            while (more){
+                more = queue.next(value, priority);
+                sink += priority;
+            }
+        });
+        Measure(backend, workload, payload, "operator=", n, n, [&]{
+            copy = queue;
+        });
+        Measure(backend, workload, payload, "operator==", n, n, [&]{
+            sink += copy == queue;
+        });
+        Measure(backend, workload, payload, "toString", n, n, [&]{
+            sink += queue.toString().size();
+        });
+    }
+
+    Measure(backend, workload, payload, "dequeue", n, n, [&]{
+        while (queue.Size() > 0)
+            sink += Consume(queue.dequeue());
+    });
+}
+
+/// @brief Run every workload on every backend for one payload type
+/// @param payload name of the value type
+/// @param n number of elements
+template<typename T>
+void RunPayload(const string& payload, int n){
+    const char* workloads[] = {"ascending", "descending", "random", "duplicates", "sawtooth", "hold"};
+
+    for (const char* workload : workloads){
+        RunWorkload<priorityqueue<T>, T>("bst", workload, payload, n);
+        RunWorkload<compactpriorityqueue<T>, T>("compact_bst", workload, payload, n);
+        RunWorkload<heappriorityqueue<T, int, less<int>, 2>, T>("binary_heap", workload, payload, n);
+        RunWorkload<heappriorityqueue<T>, T>("4ary_heap", workload, payload, n);
+    }
+}
+
+/// @brief Time the batch operations of the tree backend against the single element operations they replace:
+///        dequeue_n against dequeue, enqueue_batch against enqueue, merge against re-enqueueing through begin/next,
+///        and a bounded queue against trimming an unbounded one
+/// @param n number of elements
+void RunBatch(int n){
+    vector<int> priorities = Priorities("random", n);
+    const int batch = 1000;
+    const int shards = 8;
+    const int k = 100;
+
+    priorityqueue<int> single, batched;
+    vector<int> out;
+    for (int i = 0; i < n; i++){
+        single.enqueue(i, priorities[i]);
+        batched.enqueue(i, priorities[i]);
+    }
+    out.reserve(64);
+    Measure("bst", "random", "int", "dequeue", n, n, [&]{
+        while (single.Size() > 0)
+            sink += single.dequeue();
+    });
+    Measure("bst", "random", "int", "dequeue_n(64)", n, n, [&]{
+        while (batched.Size() > 0){
+            out.clear();
+            batched.dequeue_n(64, back_inserter(out));
+        }
+    });
+
+    vector<pair<int, int>> items(n);
+    for (int i = 0; i < n; i++)
+        items[i] = {i, priorities[i]};
+    Measure("bst", "random", "int", "enqueue", n, n, [&]{
+        for (pair<int, int>& item : items)
+            single.enqueue(item.first, item.second);
+    });
+    Measure("bst", "random", "int", "enqueue_batch(1000)", n, n, [&]{
+        for (int i = 0; i < n; i += batch)
+            batched.enqueue_batch(items.begin() + i, items.begin() + min(n, i + batch));
+    });
+
+    vector<priorityqueue<string>> copied(shards), merged(shards);
+    for (int i = 0; i < n; i++){
+        copied[i % shards].enqueue(MakeValue<string>(i), priorities[i]);
+        merged[i % shards].enqueue(MakeValue<string>(i), priorities[i]);
+    }
+    Measure("bst", "random", "string", "reenqueue(8 shards)", n, n, [&]{
+        for (int s = 1; s < shards; s++){
+            string value;
+            int priority = 0;
+            copied[s].begin();
+            bool more = copied[s].Size() > 0;
+            while (more){
+                more = copied[s].next(value, priority);
+                copied[0].enqueue(value, priority);
+            }
+            copied[s].clear();
+        }
+    });
+    Measure("bst", "random", "string", "merge(8 shards)", n, n, [&]{
+        for (int s = 1; s < shards; s++)
+            merged[0].merge(std::move(merged[s]));
+    });
+
+    //Restart from a checkpoint by parsing the toString text back in line by line, or by loading a binary snapshot
+    string text = merged[0].toString();
+    stringstream snapshot;
+    priorityqueue<string> parsed, loaded;
+    Measure("bst", "random", "string", "restore_text", n, n, [&]{
+        istringstream in(text);
+        string line;
+        while (getline(in, line)){
+            size_t separator = line.find(" value: ");
+            parsed.enqueue(line.substr(separator + 8), stoi(line.substr(0, separator)));
+        }
+    });
+    Measure("bst", "random", "string", "save", n, n, [&]{
+        merged[0].save(snapshot);
+    });
+    Measure("bst", "random", "string", "load", n, n, [&]{
+        loaded.load(snapshot);
+    });
+    sink += loaded.Size() + parsed.Size();
+
+    //Restart a queue kept in a mapped file by opening it again, next to loading a snapshot of the same elements
+    const char* path = "bench_mapped.bin";
+    priorityqueue<int> ints, intsLoaded;
+    stringstream intSnapshot;
+    mappedpriorityqueue<int> mapped;
+    remove(path);
+    mapped.open(path);
+    Measure("mapped_4ary_heap", "random", "int", "enqueue", n, n, [&]{
+        for (int i = 0; i < n; i++)
+            mapped.enqueue(i, priorities[i]);
+    });
+    Measure("mapped_4ary_heap", "random", "int", "sync", n, 1, [&]{
+        mapped.sync();
+    });
+    mapped.close();
+    Measure("mapped_4ary_heap", "random", "int", "reopen", n, 1, [&]{
+        mapped.open(path);
+    });
+    for (int i = 0; i < n; i++)
+        ints.enqueue(i, priorities[i]);
+    ints.save(intSnapshot);
+    Measure("bst", "random", "int", "load_snapshot", n, 1, [&]{
+        intsLoaded.load(intSnapshot);
+    });
+    Measure("mapped_4ary_heap", "random", "int", "dequeue", n, n, [&]{
+        while (mapped.Size() > 0)
+            sink += mapped.dequeue();
+    });
+    sink += intsLoaded.Size();
+    mapped.close();
+    remove(path);
+
+    //Values are their own priorities and the largest are best
+    priorityqueue<int, int, greater<int>> trimmed, bounded;
+    bounded.set_capacity(k);
+    Measure("bst", "random", "int", "trim_top_k(100)", n, n, [&]{
+        for (int i = 0; i < n; i++){
+            trimmed.enqueue(priorities[i], priorities[i]);
+            if (trimmed.Size() >= k * 10){ //Keep the k best by draining them and putting them back
+                out.clear();
+                trimmed.dequeue_n(k, back_inserter(out));
+                trimmed.clear();
+                for (int value : out)
+                    trimmed.enqueue(value, value);
+            }
+        }
+    });
+    Measure("bst", "random", "int", "bounded_top_k(100)", n, n, [&]{
+        for (int i = 0; i < n; i++)
+            bounded.enqueue(priorities[i], priorities[i]);
+    });
+}
+
+/// @brief Print every result as CSV with a header row
+void PrintCsv(){
+    cout << "backend,workload,payload,operation,n,ns_per_op,allocations_per_op,peak_rss_kib\n";
+    for (const RESULT& result : results){
+        cout << result.backend << ',' << result.workload << ',' << result.payload << ',' << result.operation << ','
+             << result.n << ',' << result.nsPerOp << ',' << result.allocationsPerOp << ',' << result.peakRssKiB << '\n';
+    }
+}
+
+/// @brief Print every result as a JSON array of objects
+void PrintJson(){
+    cout << "[\n";
+    for (size_t i = 0; i < results.size(); i++){
+        const RESULT& result = results[i];
+        cout << "  {\"backend\": \"" << result.backend << "\", \"workload\": \"" << result.workload
+             << "\", \"payload\": \"" << result.payload << "\", \"operation\": \"" << result.operation
+             << "\", \"n\": " << result.n << ", \"ns_per_op\": " << result.nsPerOp
+             << ", \"allocations_per_op\": " << result.allocationsPerOp
+             << ", \"peak_rss_kib\": " << result.peakRssKiB << (i + 1 < results.size() ? "},\n" : "}\n");
+    }
+    cout << "]\n";
+}
+
+int main(int argc, char* argv[]){
+    bool json = false;
+    int n = 100000;
+
+    for (int i = 1; i < argc; i++){
+        if (string(argv[i]) == "--json")
+            json = true;
+        else
+            n = max(1, atoi(argv[i]));
+    }
+
+    RunPayload<int>("int", n);
+    RunPayload<string>("string", n);
+    RunPayload<LARGE>("large", n);
+    RunBatch(n);
+
+    if (json)
+        PrintJson();
+    else
+        PrintCsv();
+    return sink == 42 ? 1 : 0;
+}
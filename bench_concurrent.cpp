@@ -0,0 +1,79 @@
+/// @filename bench_concurrent.cpp
+/// @brief Multithreaded throughput harness comparing a mutex wrapped priorityqueue with concurrentpriorityqueue.
+///        Build and run with "make benchmt".
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "priorityqueue.h"
+#include "concurrentpriorityqueue.h"
+using namespace std;
+
+/// @brief priorityqueue behind one global mutex, the baseline the concurrent queue replaces
+class LockedQueue {
+    mutex lock;
+    priorityqueue<int> queue;
+
+public:
+    void enqueue(int value, int priority){
+        lock_guard<mutex> guard(lock);
+        queue.enqueue(value, priority);
+    }
+
+    bool try_dequeue(int& value){
+        lock_guard<mutex> guard(lock);
+        if (queue.Size() == 0)
+            return false;
+        value = queue.dequeue();
+        return true;
+    }
+};
+
+/// @brief Run a hold model where every thread repeatedly dequeues one item and enqueues one new item
+/// @param name label printed with the result
+/// @param queue queue to run against, prefilled by this function
+/// @param threads number of worker threads
+/// @param opsPerThread number of dequeue/enqueue pairs per thread
+template<typename QUEUE>
+void HoldModel(const string& name, QUEUE& queue, int threads, int opsPerThread){
+    for (int i = 0; i < 100000; i++)
+        queue.enqueue(i, (i * 7919) % 100000);
+
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++){
+        workers.emplace_back([&queue, t, opsPerThread](){
+            unsigned int seed = 12345 + t;
+            int value;
+            for (int i = 0; i < opsPerThread; i++){
+                seed = seed * 1103515245 + 12345;
+                if (queue.try_dequeue(value))
+                    queue.enqueue(value, (seed >> 8) % 100000);
+            }
+        });
+    }
+    for (thread& worker : workers)
+        worker.join();
+    auto end = chrono::steady_clock::now();
+
+    double seconds = chrono::duration<double>(end - start).count();
+    cout << "hold_model " << name << " threads=" << threads
+         << " Mops/s=" << 2.0 * threads * opsPerThread / seconds / 1e6 << endl;
+}
+
+int main(){
+    const int ops = 200000;
+
+    for (int threads : {1, 2, 4, 8, 16, 32}){
+        LockedQueue locked;
+        HoldModel("global_mutex", locked, threads, ops);
+
+        concurrentpriorityqueue<int> relaxed;
+        HoldModel("relaxed", relaxed, threads, ops);
+
+        concurrentpriorityqueue<int> strict(0, true);
+        HoldModel("strict", strict, threads, ops);
+    }
+}
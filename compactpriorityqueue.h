@@ -0,0 +1,582 @@
+///@brief This header provides the compactpriorityqueue class.  It offers the enqueue, dequeue, peek, begin/next, Size,
+///       toString, assignment and equality interface of priorityqueue with the same AVL balanced BST of duplicate lists,
+///       but stores every node in one contiguous vector addressed by 32-bit indices instead of pointers.
+///       Nodes have no parent or dup fields: descents remember their path on a small stack, and each tree node's
+///       duplicate list is circular, so the tree node reaches the last duplicate and the last one reaches the first.
+///       Use it for large queues of small values, where the pointers of priorityqueue dominate the memory per element.
+///       It holds up to 2^31 - 1 elements, the most Size can report, and has no handles, iterators or range operations.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "priorityqueuecommon.h"
+
+using namespace std;
+
+template<typename T, typename Priority = int, typename Compare = std::less<Priority>>
+class compactpriorityqueue {
+private:
+    using PriorityArg = priorityqueuearg<Priority>;
+    using INDEX = uint32_t;
+
+    static constexpr INDEX NIL = UINT32_MAX;  // index of no node
+    static constexpr int MAX_SIZE = numeric_limits<int>::max();  // # of elements Size can report, keeps indices below NIL
+    static constexpr int MAX_HEIGHT = 64;  // taller than any AVL tree of 2^32 nodes, bounds the path stacks
+
+    struct NODE {
+        Priority priority;  // used to build BST
+        INDEX left;  // index of left child, NIL for none and for duplicates
+        INDEX right;  // index of right child, NIL for none and for duplicates
+        INDEX link;  // for a tree node its last duplicate, NIL without duplicates; for a duplicate the next one, the last links back to the first
+        T value;  // stored data for the p-queue
+    };
+    vector<NODE> nodes;  // every node, freed nodes are chained through link for reuse
+    vector<uint8_t> heights;  // height of the subtree rooted at each tree node, kept apart so NODE has no padding
+    INDEX root;  // index of root node of the BST
+    INDEX first;  // index of node with the smallest priority (see peek and dequeue)
+    INDEX freeList;  // index of the most recently freed node
+    int size;  // # of elements in the pqueue
+    vector<INDEX> path;  // tree nodes next still has to visit, the next one last (see begin and next)
+    INDEX curr;  // index of next item in pqueue (see begin and next)
+    INDEX currHead;  // tree node whose duplicate list contains curr
+    Compare compare;  // orders priorities, the smallest priority by this comparator is dequeued first
+
+    /// @brief Return true if priority a comes before priority b
+    /// @param a first priority
+    /// @param b second priority
+    /// @return true if a is ordered before b
+    bool Less(PriorityArg a, PriorityArg b) const {
+        return compare(a, b);
+    }
+
+    /// @brief Return the height of a subtree, 0 for an empty one
+    /// @param node index of root of the subtree
+    /// @return height of the subtree
+    int Height(INDEX node) const {
+        return node == NIL ? 0 : heights[node];
+    }
+
+    /// @brief Recompute the height of a node from the heights of its children
+    /// @param node index of node to update
+    void UpdateHeight(INDEX node){
+        heights[node] = 1 + max(Height(nodes[node].left), Height(nodes[node].right));
+    }
+
+    /// @brief Rotate a subtree left, lifting its right child into its place
+    /// @param node index of root of the subtree
+    /// @return index of the new root of the subtree
+    INDEX RotateLeft(INDEX node){
+        INDEX lifted = nodes[node].right;
+
+        nodes[node].right = nodes[lifted].left;
+        nodes[lifted].left = node;
+        UpdateHeight(node);
+        UpdateHeight(lifted);
+        return lifted;
+    }
+
+    /// @brief Rotate a subtree right, lifting its left child into its place
+    /// @param node index of root of the subtree
+    /// @return index of the new root of the subtree
+    INDEX RotateRight(INDEX node){
+        INDEX lifted = nodes[node].left;
+
+        nodes[node].left = nodes[lifted].right;
+        nodes[lifted].right = node;
+        UpdateHeight(node);
+        UpdateHeight(lifted);
+        return lifted;
+    }
+
+    /// @brief Update the height of a node and rotate its subtree back into AVL balance if one side is two taller
+    /// @param node index of root of the subtree
+    /// @return index of the new root of the subtree
+    INDEX Balance(INDEX node){
+        NODE& current = nodes[node];
+        int balance = Height(current.left) - Height(current.right);
+
+        if (balance > 1){
+            if (Height(nodes[current.left].left) < Height(nodes[current.left].right))
+                current.left = RotateLeft(current.left);
+            return RotateRight(node);
+        }
+        if (balance < -1){
+            if (Height(nodes[current.right].right) < Height(nodes[current.right].left))
+                current.right = RotateRight(current.right);
+            return RotateLeft(node);
+        }
+        UpdateHeight(node);
+        return node;
+    }
+
+    /// @brief Rebalance the nodes of a descent path from the bottom up, stopping once a subtree keeps its height
+    /// @param stack indices of the nodes on the path, the root first
+    /// @param depth number of nodes on the path
+    void Retrace(INDEX* stack, int depth){
+        for (int i = depth - 1; i >= 0; i--){
+            INDEX node = stack[i];
+            int before = heights[node];
+            INDEX top = Balance(node);
+
+            if (i == 0)
+                root = top;
+            else if (nodes[stack[i - 1]].left == node)
+                nodes[stack[i - 1]].left = top;
+            else
+                nodes[stack[i - 1]].right = top;
+
+            if (top == node && heights[node] == before)
+                return;
+        }
+    }
+
+    /// @brief Create a detached node, reusing a freed node before growing the vector
+    /// @param priority priority of the node
+    /// @param value value to copy or move into the node
+    /// @return index of the new node
+    template<typename V>
+    INDEX NewNode(PriorityArg priority, V&& value){
+        if (freeList != NIL){
+            INDEX node = freeList;
+            freeList = nodes[node].link;
+            nodes[node] = NODE{priority, NIL, NIL, NIL, std::forward<V>(value)};
+            heights[node] = 1;
+            return node;
+        }
+
+        nodes.push_back(NODE{priority, NIL, NIL, NIL, std::forward<V>(value)});
+        heights.push_back(1);
+        return nodes.size() - 1;
+    }
+
+    /// @brief Give a node back for reuse, its value is left moved from until then
+    /// @param node index of node to free
+    void FreeNode(INDEX node){
+        nodes[node].link = freeList;
+        freeList = node;
+    }
+
+    /// @brief Append a node to the end of a tree node's circular duplicate list in O(1)
+    /// @param head index of tree node owning the list
+    /// @param node index of node to append
+    void PushBack(INDEX head, INDEX node){
+        INDEX tail = nodes[head].link;
+
+        if (tail == NIL)
+            nodes[node].link = node;
+        else{
+            nodes[node].link = nodes[tail].link;
+            nodes[tail].link = node;
+        }
+        nodes[head].link = node;
+    }
+
+    /// @brief Insert a detached node into the BST by priority, append it to a duplicate list or rebalance its path
+    /// @param node index of node to insert
+    void Insert(INDEX node){
+        INDEX stack[MAX_HEIGHT];
+        int depth = 0;
+        INDEX current = root;
+        PriorityArg priority = nodes[node].priority;
+
+        size++;
+        curr = NIL;
+        if (root == NIL){
+            root = node;
+            first = node;
+            return;
+        }
+
+        while (true){
+            stack[depth++] = current;
+            if (Less(priority, nodes[current].priority)){ //Traverse left
+                if (nodes[current].left == NIL){
+                    nodes[current].left = node;
+                    break;
+                }
+                current = nodes[current].left;
+            }
+            else if (Less(nodes[current].priority, priority)){ //Traverse right
+                if (nodes[current].right == NIL){
+                    nodes[current].right = node;
+                    break;
+                }
+                current = nodes[current].right;
+            }
+            else{ //Duplicate
+                PushBack(current, node);
+                return;
+            }
+        }
+
+        if (Less(priority, nodes[first].priority))
+            first = node;
+        Retrace(stack, depth);
+    }
+
+    /// @brief Advance curr and currHead to the next node inorder, through the duplicate list of currHead first and
+    ///        then to the next tree node, which is the leftmost node of the right subtree or the innermost node on path
+    void Advance(){
+        INDEX tail = nodes[currHead].link;
+
+        if (tail != NIL && curr != tail){
+            curr = curr == currHead ? nodes[tail].link : nodes[curr].link;
+            return;
+        }
+
+        for (INDEX node = nodes[currHead].right; node != NIL; node = nodes[node].left)
+            path.push_back(node);
+        if (path.empty()){
+            curr = NIL;
+            currHead = NIL;
+            return;
+        }
+        currHead = path.back();
+        curr = currHead;
+        path.pop_back();
+    }
+
+    /// @brief Return true if two duplicate lists have the same values in the same order
+    /// @param mine index of tree node of a list in this tree
+    /// @param other the tree the other list belongs to
+    /// @param others index of tree node of the other list
+    /// @return true if the values of both lists are equal
+    bool SameList(INDEX mine, const compactpriorityqueue& other, INDEX others) const {
+        INDEX myTail = nodes[mine].link;
+        INDEX otherTail = other.nodes[others].link;
+
+        if (!(nodes[mine].value == other.nodes[others].value) || (myTail == NIL) != (otherTail == NIL))
+            return false;
+        if (myTail == NIL)
+            return true;
+
+        INDEX a = nodes[myTail].link;
+        INDEX b = other.nodes[otherTail].link;
+        while (true){
+            if (!(nodes[a].value == other.nodes[b].value))
+                return false;
+            if (a == myTail || b == otherTail)
+                return a == myTail && b == otherTail;
+            a = nodes[a].link;
+            b = other.nodes[b].link;
+        }
+    }
+
+public:
+    //
+    // default constructor:
+    //
+    // Creates an empty priority queue.
+    // O(1)
+    //
+    compactpriorityqueue()
+        : root(NIL), first(NIL), freeList(NIL), size(0), curr(NIL), currHead(NIL), compare() {}
+
+    //
+    // comparator constructor:
+    //
+    // Creates an empty priority queue ordered by the given comparator.
+    // O(1)
+    //
+    explicit compactpriorityqueue(const Compare& compare) : compactpriorityqueue() {
+        this->compare = compare;
+    }
+
+    //
+    // copy constructor and operator=:
+    //
+    // Indices stay valid in a copy, so copying the vectors copies the tree
+    // with the same shape.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    compactpriorityqueue(const compactpriorityqueue& other) = default;
+    compactpriorityqueue& operator=(const compactpriorityqueue& other) = default;
+
+    //
+    // move constructor:
+    //
+    // Takes over the nodes of the "other" priority queue, leaving it empty.
+    // O(1)
+    //
+    compactpriorityqueue(compactpriorityqueue&& other) noexcept : compactpriorityqueue(other.compare) {
+        *this = std::move(other);
+    }
+
+    //
+    // move operator=
+    //
+    // Takes over the nodes of the "other" priority queue, leaving it empty.
+    // O(1)
+    //
+    compactpriorityqueue& operator=(compactpriorityqueue&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        nodes = std::move(other.nodes);
+        heights = std::move(other.heights);
+        root = other.root;
+        first = other.first;
+        freeList = other.freeList;
+        size = other.size;
+        compare = other.compare;
+        curr = NIL;
+        currHead = NIL;
+        other.clear();
+        return *this;
+    }
+
+    //
+    // clear:
+    //
+    // Frees the memory associated with the priority queue but is public.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    void clear() {
+        vector<NODE>().swap(nodes);
+        vector<uint8_t>().swap(heights);
+        vector<INDEX>().swap(path);
+        root = NIL;
+        first = NIL;
+        freeList = NIL;
+        size = 0;
+        curr = NIL;
+        currHead = NIL;
+    }
+
+    //
+    // reserve:
+    //
+    // Preallocates node storage so that the queue can hold n elements without
+    // growing its vectors.  Dequeued nodes are reused.
+    // O(n)
+    //
+    void reserve(int n) {
+        nodes.reserve(n);
+        heights.reserve(n);
+    }
+
+    //
+    // enqueue:
+    //
+    // Inserts the value into the custom BST in the correct location based on
+    // priority, at the end of the duplicate list for an equal priority.
+    // Returns false without inserting if the queue already holds 2^31 - 1
+    // elements.  Freed nodes are reused, so node indices stay below that
+    // count and never reach NIL.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    bool enqueue(const T& value, PriorityArg priority) {
+        if (size == MAX_SIZE)
+            return false;
+        Insert(NewNode(priority, value));
+        return true;
+    }
+
+    //
+    // enqueue (move):
+    //
+    // Same as enqueue, but moves the value into the queue instead of copying it.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    bool enqueue(T&& value, PriorityArg priority) {
+        if (size == MAX_SIZE)
+            return false;
+        Insert(NewNode(priority, std::move(value)));
+        return true;
+    }
+
+    //
+    // dequeue:
+    //
+    // returns the value of the next element in the priority queue and removes
+    // the element from the priority queue.  A minimum with duplicates takes
+    // the value of its first duplicate in O(1); otherwise the leftmost path
+    // is walked to unlink the minimum and rebalance.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    T dequeue() {
+        if (root == NIL)
+            return T{};
+
+        INDEX minimum = first;
+        INDEX tail = nodes[minimum].link;
+        T valueOut = std::move(nodes[minimum].value);
+
+        size--;
+        curr = NIL;
+        if (tail != NIL){
+            INDEX next = nodes[tail].link;
+            nodes[minimum].value = std::move(nodes[next].value);
+            if (next == tail)
+                nodes[minimum].link = NIL;
+            else
+                nodes[tail].link = nodes[next].link;
+            FreeNode(next);
+            return valueOut;
+        }
+
+        INDEX stack[MAX_HEIGHT];
+        int depth = 0;
+        for (INDEX node = root; node != minimum; node = nodes[node].left)
+            stack[depth++] = node;
+
+        //The minimum has no left child, and in an AVL tree its right child, if any, is a leaf and the next minimum
+        INDEX right = nodes[minimum].right;
+        if (depth == 0)
+            root = right;
+        else
+            nodes[stack[depth - 1]].left = right;
+        first = right != NIL ? right : depth > 0 ? stack[depth - 1] : NIL;
+        FreeNode(minimum);
+        Retrace(stack, depth);
+        return valueOut;
+    }
+
+    //
+    // peek:
+    //
+    // returns the value of the next element in the priority queue but does not
+    // remove the item from the priority queue.
+    // O(1), the node with the smallest priority is cached
+    //
+    T peek() {
+        if (root == NIL)
+            return T{};
+
+        return nodes[first].value;
+    }
+
+    //
+    // peekPriority:
+    //
+    // returns the priority of the next element in the priority queue, or a
+    // default constructed priority if the queue is empty.
+    // O(1), the node with the smallest priority is cached
+    //
+    Priority peekPriority() {
+        if (root == NIL)
+            return Priority{};
+
+        return nodes[first].priority;
+    }
+
+    //
+    // begin
+    //
+    // Resets internal state for an inorder traversal.  After the
+    // call to begin(), the internal state denotes the first inorder
+    // node; this ensure that first call to next() function returns
+    // the first inorder node value.  Enqueueing or dequeueing ends the
+    // traversal.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    void begin() {
+        path.clear();
+        curr = NIL;
+        currHead = NIL;
+        for (INDEX node = root; node != NIL; node = nodes[node].left)
+            path.push_back(node);
+        if (path.empty())
+            return;
+
+        currHead = path.back();
+        curr = currHead;
+        path.pop_back();
+    }
+
+    //
+    // next
+    //
+    // Uses the internal state to return the next inorder priority, and
+    // then advances the internal state in anticipation of future
+    // calls.  Returns true if more values/priorities remain after the one
+    // returned, false once the last one has been returned, see
+    // priorityqueue::next.
+    // O(logn) worst case, O(1) amortized over a whole traversal
+    //
+    bool next(T& value, Priority &priority) {
+        if (curr == NIL)
+            return false;
+
+        value = nodes[curr].value;
+        priority = nodes[currHead].priority;
+
+        Advance();
+        return curr != NIL;
+    }
+
+    //
+    // toString:
+    //
+    // Returns a string of the entire priority queue, in order, in the format
+    // of priorityqueue::toString.  Uses the traversal state of begin/next.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    string toString() {
+        ostringstream ss;
+
+        for (begin(); curr != NIL; Advance())
+            ss << nodes[currHead].priority << " value: " << nodes[curr].value << '\n';
+        return ss.str();
+    }
+
+    //
+    // ==operator
+    //
+    // Returns true if this priority queue has the same shape, priorities and
+    // duplicate lists as the priority queue passed in as other.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    bool operator==(const compactpriorityqueue& other) const {
+        vector<pair<INDEX, INDEX>> stack;
+
+        if (size != other.size)
+            return false;
+        stack.emplace_back(root, other.root);
+        while (!stack.empty()){
+            auto [mine, others] = stack.back();
+            stack.pop_back();
+
+            if (mine == NIL || others == NIL){
+                if (mine != others)
+                    return false;
+                continue;
+            }
+            if (Less(nodes[mine].priority, other.nodes[others].priority)
+                || Less(other.nodes[others].priority, nodes[mine].priority) || !SameList(mine, other, others))
+                return false;
+            stack.emplace_back(nodes[mine].right, other.nodes[others].right);
+            stack.emplace_back(nodes[mine].left, other.nodes[others].left);
+        }
+        return true;
+    }
+
+    //
+    // bytes_allocated:
+    //
+    // Returns the bytes of node storage held by the queue, including freed
+    // nodes kept for reuse.
+    // O(1)
+    //
+    size_t bytes_allocated() const {
+        return nodes.capacity() * sizeof(NODE) + heights.capacity() * sizeof(uint8_t);
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of elements in the priority queue, 0 if empty.
+    // O(1)
+    //
+    int Size() {
+        return size;
+    }
+};
@@ -0,0 +1,304 @@
+///@brief This header provides the concurrentpriorityqueue class, a thread safe priority queue for many producers and
+///       consumers with the enqueue, dequeue, peek and Size interface of priorityqueue.
+///       Elements are spread over several shards, each a heappriorityqueue behind its own mutex, so producers and
+///       consumers on different shards never contend.  Every element also gets a global sequence number so equal
+///       priorities keep their enqueue order across shards.
+///
+///       Two dequeue orderings are available:
+///         relaxed (default) - MultiQueue style, dequeue takes the better front of two random shards.  The result is
+///                             close to, but not always exactly, the smallest priority; throughput scales with threads.
+///         strict            - dequeue locks every shard and takes the true smallest priority, in FIFO order for
+///                             equal priorities.  Enqueue still scales, dequeue is serialized.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include "heappriorityqueue.h"
+
+using namespace std;
+
+template<typename T, typename Priority = int, typename Compare = std::less<Priority>>
+class concurrentpriorityqueue {
+private:
+    struct KEY {
+        Priority priority;  // priority given to enqueue
+        unsigned long long seq;  // global enqueue order, breaks ties between shards
+    };
+
+    struct KEYCOMPARE {
+        Compare compare;  // orders priorities
+
+        bool operator()(const KEY& a, const KEY& b) const {
+            if (compare(a.priority, b.priority))
+                return true;
+            if (compare(b.priority, a.priority))
+                return false;
+            return a.seq < b.seq;
+        }
+    };
+
+    struct alignas(64) SHARD {
+        mutex lock;  // guards every other member of the shard
+        heappriorityqueue<T, KEY, KEYCOMPARE> queue;  // elements of this shard
+        KEY top;  // key of the shard's front element, valid when the shard is not empty
+
+        SHARD(const Compare& compare) : queue(KEYCOMPARE{compare}) {}
+    };
+
+    unique_ptr<unique_ptr<SHARD>[]> shards;  // shards are allocated separately so each sits on its own cache lines
+    int shardCount;  // # of shards
+    bool strict;  // true if dequeue must return the exact smallest priority
+    KEYCOMPARE keyCompare;  // orders keys across shards
+    atomic<unsigned long long> nextSeq;  // sequence number given to the next enqueued element
+    atomic<int> size;  // # of elements across all shards
+    atomic<int> waiting;  // # of threads blocked in dequeue_wait
+    mutex waitLock;  // guards the condition variable used by dequeue_wait
+    condition_variable notEmpty;  // signalled when an element is enqueued while a thread waits
+
+    /// @brief Return a random number from a generator owned by the calling thread
+    /// @return random unsigned number
+    static unsigned int Random(){
+        thread_local minstd_rand generator(hash<thread::id>()(this_thread::get_id()));
+        return generator();
+    }
+
+    /// @brief Remove the front element of a locked, non-empty shard and refresh the shard's cached front key
+    /// @param shard shard to dequeue from, its lock must be held
+    /// @return the removed value
+    T PopShard(SHARD& shard){
+        T valueOut = shard.queue.dequeue();
+        if (shard.queue.Size() > 0)
+            shard.top = shard.queue.peekPriority();
+        size--;
+        return valueOut;
+    }
+
+    /// @brief Dequeue the element with the smallest key across all shards, locking every shard in index order
+    /// @param value set to the removed value
+    /// @return true if an element was removed, false if the queue was empty
+    bool StrictDequeue(T& value){
+        for (int i = 0; i < shardCount; i++)
+            shards[i]->lock.lock();
+
+        SHARD* best = nullptr;
+        for (int i = 0; i < shardCount; i++){
+            SHARD* shard = shards[i].get();
+            if (shard->queue.Size() > 0 && (best == nullptr || keyCompare(shard->top, best->top)))
+                best = shard;
+        }
+        if (best != nullptr)
+            value = PopShard(*best);
+
+        for (int i = shardCount - 1; i >= 0; i--)
+            shards[i]->lock.unlock();
+        return best != nullptr;
+    }
+
+    /// @brief Dequeue the better front of two random shards, falling back to scanning every shard when the random
+    ///        choices keep coming up empty or locked.  A single shard has no second shard to pick, so it is scanned
+    /// @param value set to the removed value
+    /// @return true if an element was removed, false if the queue was empty
+    bool RelaxedDequeue(T& value){
+        for (int attempt = 0; shardCount > 1 && attempt < 2 * shardCount && size > 0; attempt++){
+            int i = Random() % shardCount;
+            int j = Random() % shardCount;
+            if (i == j)
+                j = (j + 1) % shardCount;
+
+            unique_lock<mutex> first(shards[i]->lock, try_to_lock);
+            if (!first.owns_lock())
+                continue;
+            unique_lock<mutex> second(shards[j]->lock, try_to_lock);
+            if (!second.owns_lock())
+                continue;
+
+            SHARD* a = shards[i].get();
+            SHARD* b = shards[j].get();
+            if (a->queue.Size() == 0 || (b->queue.Size() > 0 && keyCompare(b->top, a->top)))
+                swap(a, b);
+            if (a->queue.Size() > 0){
+                value = PopShard(*a);
+                return true;
+            }
+        }
+
+        for (int i = 0; i < shardCount && size > 0; i++){
+            lock_guard<mutex> guard(shards[i]->lock);
+            if (shards[i]->queue.Size() > 0){
+                value = PopShard(*shards[i]);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Insert a key and value into a random shard, preferring shards that are not locked, then wake a waiting
+    ///        consumer if there is one
+    /// @param key key of the new element
+    /// @param value value to insert
+    template<typename VALUE>
+    void Insert(const KEY& key, VALUE&& value){
+        int index = Random() % shardCount;
+        unique_lock<mutex> guard(shards[index]->lock, try_to_lock);
+
+        for (int attempt = 0; !guard.owns_lock() && attempt < shardCount; attempt++){
+            index = Random() % shardCount;
+            guard = unique_lock<mutex>(shards[index]->lock, try_to_lock);
+        }
+        if (!guard.owns_lock())
+            guard = unique_lock<mutex>(shards[index]->lock);
+
+        SHARD& shard = *shards[index];
+        if (shard.queue.Size() == 0 || keyCompare(key, shard.top))
+            shard.top = key;
+        shard.queue.enqueue(std::forward<VALUE>(value), key);
+        size++;
+        guard.unlock();
+
+        if (waiting > 0){
+            lock_guard<mutex> wake(waitLock);
+            notEmpty.notify_one();
+        }
+    }
+
+public:
+    //
+    // constructor:
+    //
+    // Creates an empty concurrent priority queue.  shards is the number of
+    // independent sub-queues, by default twice the hardware thread count.
+    // strict selects exact ordering instead of the relaxed MultiQueue order.
+    // O(s), where s is the number of shards
+    //
+    explicit concurrentpriorityqueue(int shards = 0, bool strict = false, const Compare& compare = Compare())
+        : shardCount(shards > 0 ? shards : max(2, 2 * int(thread::hardware_concurrency()))), strict(strict),
+          keyCompare{compare}, nextSeq(0), size(0), waiting(0) {
+        this->shards.reset(new unique_ptr<SHARD>[shardCount]);
+        for (int i = 0; i < shardCount; i++)
+            this->shards[i].reset(new SHARD(compare));
+    }
+
+    concurrentpriorityqueue(const concurrentpriorityqueue&) = delete;
+    concurrentpriorityqueue& operator=(const concurrentpriorityqueue&) = delete;
+
+    //
+    // enqueue:
+    //
+    // Inserts the value into one shard.  Safe to call from any thread.
+    // O(logn), where n is the number of elements in the shard
+    //
+    void enqueue(const T& value, const Priority& priority) {
+        Insert(KEY{priority, nextSeq++}, value);
+    }
+
+    //
+    // enqueue (move):
+    //
+    // Same as enqueue, but moves the value into the queue instead of copying it.
+    // O(logn), where n is the number of elements in the shard
+    //
+    void enqueue(T&& value, const Priority& priority) {
+        Insert(KEY{priority, nextSeq++}, std::move(value));
+    }
+
+    //
+    // try_dequeue:
+    //
+    // Removes the next element, by relaxed or strict order, into value.
+    // Returns false without waiting if the queue is empty.
+    // O(logn) relaxed, O(s + logn) strict, where s is the number of shards
+    //
+    bool try_dequeue(T& value) {
+        if (size == 0)
+            return false;
+        return strict ? StrictDequeue(value) : RelaxedDequeue(value);
+    }
+
+    //
+    // dequeue:
+    //
+    // returns the value of the next element and removes it from the queue,
+    // or a default constructed value if the queue is empty.
+    // O(logn) relaxed, O(s + logn) strict, where s is the number of shards
+    //
+    T dequeue() {
+        T value{};
+        try_dequeue(value);
+        return value;
+    }
+
+    //
+    // dequeue_wait:
+    //
+    // Like try_dequeue, but blocks until an element is available or the
+    // timeout expires.  Returns false on timeout.
+    //
+    template<typename Rep, typename Period>
+    bool dequeue_wait(T& value, const chrono::duration<Rep, Period>& timeout) {
+        if (try_dequeue(value))
+            return true;
+
+        auto deadline = chrono::steady_clock::now() + timeout;
+        unique_lock<mutex> guard(waitLock);
+        waiting++;
+        while (true){
+            if (size > 0){
+                guard.unlock();
+                bool found = try_dequeue(value);
+                guard.lock();
+                if (found)
+                    break;
+                continue;
+            }
+            if (notEmpty.wait_until(guard, deadline) == cv_status::timeout && size == 0){
+                waiting--;
+                return false;
+            }
+        }
+        waiting--;
+        return true;
+    }
+
+    //
+    // peek:
+    //
+    // returns the value of the element with the smallest priority at the
+    // moment each shard is inspected, or a default constructed value if the
+    // queue is empty.  Other threads may dequeue it before the caller does.
+    // O(s), where s is the number of shards
+    //
+    T peek() {
+        for (int i = 0; i < shardCount; i++)
+            shards[i]->lock.lock();
+
+        SHARD* best = nullptr;
+        for (int i = 0; i < shardCount; i++){
+            SHARD* shard = shards[i].get();
+            if (shard->queue.Size() > 0 && (best == nullptr || keyCompare(shard->top, best->top)))
+                best = shard;
+        }
+        T value = best == nullptr ? T{} : best->queue.peek();
+
+        for (int i = shardCount - 1; i >= 0; i--)
+            shards[i]->lock.unlock();
+        return value;
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of elements in the priority queue, 0 if empty.
+    // O(1)
+    //
+    int Size() {
+        return size;
+    }
+};
@@ -0,0 +1,206 @@
+///@brief This header provides the heappriorityqueue class.  It offers the enqueue, dequeue, peek and Size interface of
+///       priorityqueue, but stores elements in a d-ary heap in one contiguous array instead of a linked BST.
+///       Use it when a workload only needs enqueue/dequeue/peek; there is no inorder traversal.
+///       Equal priorities are dequeued in the order they were enqueued using a sequence number per element.
+///       The Arity template parameter selects a binary (2), 4-ary (default) or any d-ary heap.
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "priorityqueuecommon.h"
+
+using namespace std;
+
+template<typename T, typename Priority = int, typename Compare = std::less<Priority>, int Arity = 4>
+class heappriorityqueue {
+private:
+    using PriorityArg = priorityqueuearg<Priority>;
+
+    struct ENTRY {
+        Priority priority;  // used to order the heap
+        unsigned long long seq;  // enqueue order, breaks ties so equal priorities stay FIFO
+        T value;  // stored data for the p-queue
+    };
+    vector<ENTRY> heap;  // heap ordered entries, the front is the next to dequeue
+    unsigned long long nextSeq;  // sequence number given to the next enqueued entry
+    heaporder<Priority, Compare, Arity> order;  // orders entries, the smallest priority by its comparator is dequeued first
+
+public:
+    //
+    // default constructor:
+    //
+    // Creates an empty priority queue.
+    // O(1)
+    //
+    heappriorityqueue() : nextSeq(0), order() {}
+
+    //
+    // comparator constructor:
+    //
+    // Creates an empty priority queue ordered by the given comparator.
+    // O(1)
+    //
+    explicit heappriorityqueue(const Compare& compare) : nextSeq(0), order{compare} {}
+
+    //
+    // clear:
+    //
+    // Removes every element, keeping the storage for reuse.
+    // O(n), where n is the number of elements
+    //
+    void clear() {
+        heap.clear();
+        nextSeq = 0;
+    }
+
+    //
+    // reserve:
+    //
+    // Preallocates storage so the queue can hold n elements without
+    // requesting more memory.
+    // O(n)
+    //
+    void reserve(int n) {
+        heap.reserve(n);
+    }
+
+    //
+    // enqueue:
+    //
+    // Appends the value at the end of the heap and sifts it up to its place.
+    // O(logn), where n is the number of elements
+    //
+    void enqueue(const T& value, PriorityArg priority) {
+        heap.push_back(ENTRY{priority, nextSeq++, value});
+        order.SiftUp(heap.data(), heap.size() - 1);
+    }
+
+    //
+    // enqueue (move):
+    //
+    // Same as enqueue, but moves the value into the queue instead of copying it.
+    // O(logn), where n is the number of elements
+    //
+    void enqueue(T&& value, PriorityArg priority) {
+        heap.push_back(ENTRY{priority, nextSeq++, std::move(value)});
+        order.SiftUp(heap.data(), heap.size() - 1);
+    }
+
+    //
+    // emplace:
+    //
+    // Same as enqueue, but constructs the value from the given constructor
+    // arguments.
+    // O(logn), where n is the number of elements
+    //
+    template<typename... Args>
+    void emplace(PriorityArg priority, Args&&... args) {
+        heap.push_back(ENTRY{priority, nextSeq++, T(std::forward<Args>(args)...)});
+        order.SiftUp(heap.data(), heap.size() - 1);
+    }
+
+    //
+    // merge:
+    //
+    // Moves every element of the "other" priority queue into this one,
+    // leaving "other" empty.  Equal priorities from "other" come after the
+    // ones already in this queue.  A small queue is sifted in one element at
+    // a time, a large one is appended and the whole heap is rebuilt bottom up.
+    // O(min(m logn, n + m)), where n and m are the numbers of elements
+    //
+    void merge(heappriorityqueue&& other) {
+        if (this == &other || other.heap.empty())
+            return;
+
+        size_t count = heap.size();
+        unsigned long long base = nextSeq;
+        nextSeq += other.nextSeq;
+
+        heap.reserve(count + other.heap.size());
+        for (ENTRY& entry : other.heap){
+            entry.seq += base;
+            heap.push_back(std::move(entry));
+        }
+        other.clear();
+
+        size_t depth = 1;
+        for (size_t n = count; n > 0; n /= Arity)
+            depth++;
+
+        if ((heap.size() - count) * depth < heap.size()){
+            for (size_t i = count; i < heap.size(); i++)
+                order.SiftUp(heap.data(), i);
+        }
+        else{
+            for (size_t i = heap.size() / Arity + 1; i-- > 0; )
+                order.SiftDown(heap.data(), heap.size(), i);
+        }
+    }
+
+    //
+    // dequeue:
+    //
+    // returns the value of the next element in the priority queue and removes
+    // the element from the priority queue.  The last element fills the hole
+    // at the front and sifts down.
+    // O(d logn / logd), where n is the number of elements and d is the arity
+    //
+    T dequeue() {
+        if (heap.empty())
+            return T{};
+
+        T valueOut = std::move(heap.front().value);
+
+        if (heap.size() > 1){
+            heap.front() = std::move(heap.back());
+            heap.pop_back();
+            order.SiftDown(heap.data(), heap.size(), 0);
+        }
+        else
+            heap.pop_back();
+
+        return valueOut;
+    }
+
+    //
+    // peek:
+    //
+    // returns the value of the next element in the priority queue but does not
+    // remove the item from the priority queue.
+    // O(1)
+    //
+    T peek() {
+        if (heap.empty())
+            return T{};
+
+        return heap.front().value;
+    }
+
+    //
+    // peekPriority:
+    //
+    // returns the priority of the next element in the priority queue, or a
+    // default constructed priority if the queue is empty.
+    // O(1)
+    //
+    Priority peekPriority() {
+        if (heap.empty())
+            return Priority{};
+
+        return heap.front().priority;
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of elements in the priority queue, 0 if empty.
+    // O(1)
+    //
+    int Size() {
+        return heap.size();
+    }
+};
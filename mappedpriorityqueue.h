@@ -0,0 +1,349 @@
+///@brief This header provides the mappedpriorityqueue class.  It offers the enqueue, dequeue, peek and Size interface of
+///       priorityqueue, but keeps its elements in a file mapped into memory, so the queue outlives the process and
+///       reopening it only maps the file again instead of parsing and rebuilding it.
+///       The elements form a d-ary heap in one contiguous array after a small header, so children and parents are
+///       found by index arithmetic and the file holds no pointers.  T and Priority must be trivially copyable.
+///       Equal priorities are dequeued in the order they were enqueued using a sequence number per element.
+///       sync flushes the mapped pages to the file with msync at points chosen by the caller.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "priorityqueuecommon.h"
+
+using namespace std;
+
+template<typename T, typename Priority = int, typename Compare = std::less<Priority>, int Arity = 4>
+class mappedpriorityqueue {
+    static_assert(is_trivially_copyable<T>::value, "values are stored as raw bytes in the mapped file");
+    static_assert(is_trivially_copyable<Priority>::value, "priorities are stored as raw bytes in the mapped file");
+    static_assert(alignof(T) <= 64 && alignof(Priority) <= 64, "entries start on a cache line in the mapped file");
+
+private:
+    using PriorityArg = priorityqueuearg<Priority>;
+
+    struct ENTRY {
+        Priority priority;  // used to order the heap
+        unsigned long long seq;  // enqueue order, breaks ties so equal priorities stay FIFO
+        T value;  // stored data for the p-queue
+    };
+
+    /// @brief First bytes of the file, the entries start at DATA_OFFSET.  Fields are in the byte order of the machine
+    struct HEADER {
+        char magic[8];  // "BSPQHEAP"
+        uint32_t version;  // file format version, open rejects any other
+        uint32_t entrySize;  // sizeof(ENTRY) of the queue that created the file
+        uint64_t count;  // # of entries in the heap
+        uint64_t capacity;  // # of entries the file has room for
+        uint64_t nextSeq;  // sequence number given to the next enqueued entry
+        uint64_t dirty;  // set while the file may hold changes made since the last sync or close
+    };
+    static constexpr char MAGIC[8] = {'B', 'S', 'P', 'Q', 'H', 'E', 'A', 'P'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t DATA_OFFSET = (sizeof(HEADER) + 63) / 64 * 64;  // keeps the entries cache line aligned
+    static constexpr uint64_t INITIAL_CAPACITY = 1024;
+
+    int fd;  // descriptor of the open file, -1 when closed
+    HEADER* header;  // start of the mapping, nullptr when closed
+    ENTRY* heap;  // heap ordered entries inside the mapping, the front is the next to dequeue
+    size_t mappedBytes;  // length of the mapping
+    heaporder<Priority, Compare, Arity> order;  // orders entries, the smallest priority by its comparator is dequeued first
+
+    /// @brief Map the first bytes of the open file, replacing any previous mapping only once the new one exists
+    /// @param bytes length of the file to map
+    /// @return true if the file was mapped, false if the previous mapping is still in place
+    bool Map(size_t bytes){
+        void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        if (header != nullptr)
+            munmap(header, mappedBytes);
+        header = static_cast<HEADER*>(mapping);
+        heap = reinterpret_cast<ENTRY*>(static_cast<char*>(mapping) + DATA_OFFSET);
+        mappedBytes = bytes;
+        return true;
+    }
+
+    /// @brief Grow the file and the mapping so the heap has room for at least the given number of entries
+    /// @param capacity number of entries needed
+    /// @return true if there is room, false if the file could not be grown and the queue is unchanged
+    bool Grow(uint64_t capacity){
+        if (capacity <= header->capacity)
+            return true;
+
+        capacity = max(capacity, header->capacity * 2);
+        size_t bytes = DATA_OFFSET + capacity * sizeof(ENTRY);
+        if (ftruncate(fd, bytes) != 0 || !Map(bytes))
+            return false;
+        header->capacity = capacity;
+        return true;
+    }
+
+    /// @brief Mark the file as changed since the last sync, flushing the flag first so a crash before the next sync
+    ///        is noticed by open
+    void Touch(){
+        if (header->dirty)
+            return;
+        header->dirty = 1;
+        msync(header, DATA_OFFSET, MS_SYNC);
+    }
+
+public:
+    //
+    // default constructor:
+    //
+    // Creates a closed priority queue, see open.
+    // O(1)
+    //
+    mappedpriorityqueue() : fd(-1), header(nullptr), heap(nullptr), mappedBytes(0), order() {}
+
+    //
+    // comparator constructor:
+    //
+    // Creates a closed priority queue ordered by the given comparator.  A
+    // file must always be opened with the comparator that created it.
+    // O(1)
+    //
+    explicit mappedpriorityqueue(const Compare& compare)
+        : fd(-1), header(nullptr), heap(nullptr), mappedBytes(0), order{compare} {}
+
+    mappedpriorityqueue(const mappedpriorityqueue&) = delete;
+    mappedpriorityqueue& operator=(const mappedpriorityqueue&) = delete;
+
+    //
+    // destructor:
+    //
+    // Closes the file, see close.
+    // O(d), where d is the number of dirty pages
+    //
+    ~mappedpriorityqueue() {
+        close();
+    }
+
+    //
+    // open:
+    //
+    // Opens the queue stored in the file at path, creating an empty one if
+    // the file does not exist or is empty, and closes any file opened before.
+    // The file is mapped, not read, so reopening a large queue is O(1).  If
+    // the process ended without calling sync or close after changing the
+    // queue, the heap order is repaired; an operation cut off half way may
+    // have lost or duplicated an element.  Returns false if the file cannot
+    // be opened or mapped, or was written by another format version or a
+    // queue with a different element layout.
+    // O(1) for a file that was closed cleanly, O(n) otherwise
+    //
+    bool open(const string& path) {
+        struct stat status;
+
+        close();
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+
+        if (fstat(fd, &status) != 0){
+            close();
+            return false;
+        }
+
+        if (status.st_size == 0){
+            size_t bytes = DATA_OFFSET + INITIAL_CAPACITY * sizeof(ENTRY);
+            if (ftruncate(fd, bytes) != 0 || !Map(bytes)){
+                close();
+                return false;
+            }
+            memcpy(header->magic, MAGIC, sizeof(MAGIC));
+            header->version = VERSION;
+            header->entrySize = sizeof(ENTRY);
+            header->capacity = INITIAL_CAPACITY;
+            return true;
+        }
+
+        if (size_t(status.st_size) < DATA_OFFSET || !Map(status.st_size)){
+            close();
+            return false;
+        }
+        if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+            || header->entrySize != sizeof(ENTRY) || header->count > header->capacity
+            || header->capacity > (mappedBytes - DATA_OFFSET) / sizeof(ENTRY)){
+            munmap(header, mappedBytes);
+            header = nullptr;
+            close();
+            return false;
+        }
+
+        if (header->dirty){
+            for (size_t i = header->count / Arity + 1; i-- > 0; ){
+                if (i < header->count)
+                    order.SiftDown(heap, header->count, i);
+            }
+        }
+        return true;
+    }
+
+    //
+    // is_open:
+    //
+    // Returns true if a file is open.
+    // O(1)
+    //
+    bool is_open() const {
+        return header != nullptr;
+    }
+
+    //
+    // sync:
+    //
+    // Flushes every change to the file with msync and waits for the write to
+    // finish, so the queue survives a crash of the machine from here on until
+    // it is changed again.  Returns false if no file is open or the flush
+    // fails.
+    // O(d), where d is the number of dirty pages
+    //
+    bool sync() {
+        if (header == nullptr)
+            return false;
+        if (msync(header, mappedBytes, MS_SYNC) != 0)
+            return false;
+
+        header->dirty = 0;
+        return msync(header, DATA_OFFSET, MS_SYNC) == 0;
+    }
+
+    //
+    // close:
+    //
+    // Syncs and unmaps the file.  Does nothing if no file is open.
+    // O(d), where d is the number of dirty pages
+    //
+    void close() {
+        if (header != nullptr){
+            sync();
+            munmap(header, mappedBytes);
+        }
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+        header = nullptr;
+        heap = nullptr;
+        mappedBytes = 0;
+    }
+
+    //
+    // clear:
+    //
+    // Removes every element, keeping the file at its size for reuse.
+    // O(1)
+    //
+    void clear() {
+        if (header == nullptr)
+            return;
+        Touch();
+        header->count = 0;
+        header->nextSeq = 0;
+    }
+
+    //
+    // reserve:
+    //
+    // Grows the file so the queue can hold n elements without remapping.
+    // Returns false if no file is open or the file cannot be grown.
+    // O(1)
+    //
+    bool reserve(int n) {
+        return header != nullptr && Grow(n);
+    }
+
+    //
+    // enqueue:
+    //
+    // Appends the value at the end of the heap and sifts it up to its place,
+    // doubling the file when it is full.  Returns false if no file is open or
+    // the file cannot be grown.
+    // O(logn), where n is the number of elements
+    //
+    bool enqueue(const T& value, PriorityArg priority) {
+        if (header == nullptr || !Grow(header->count + 1))
+            return false;
+
+        Touch();
+        heap[header->count] = ENTRY{priority, header->nextSeq++, value};
+        header->count++;
+        order.SiftUp(heap, header->count - 1);
+        return true;
+    }
+
+    //
+    // dequeue:
+    //
+    // returns the value of the next element in the priority queue and removes
+    // the element from the priority queue.  The last element fills the hole
+    // at the front and sifts down.
+    // O(d logn / logd), where n is the number of elements and d is the arity
+    //
+    T dequeue() {
+        if (header == nullptr || header->count == 0)
+            return T{};
+
+        T valueOut = heap[0].value;
+
+        Touch();
+        header->count--;
+        if (header->count > 0){
+            heap[0] = heap[header->count];
+            order.SiftDown(heap, header->count, 0);
+        }
+        return valueOut;
+    }
+
+    //
+    // peek:
+    //
+    // returns the value of the next element in the priority queue but does not
+    // remove the item from the priority queue.
+    // O(1)
+    //
+    T peek() {
+        if (header == nullptr || header->count == 0)
+            return T{};
+
+        return heap[0].value;
+    }
+
+    //
+    // peekPriority:
+    //
+    // returns the priority of the next element in the priority queue, or a
+    // default constructed priority if the queue is empty.
+    // O(1)
+    //
+    Priority peekPriority() {
+        if (header == nullptr || header->count == 0)
+            return Priority{};
+
+        return heap[0].priority;
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of elements in the priority queue, 0 if empty or closed.
+    // O(1)
+    //
+    int Size() {
+        if (header == nullptr)
+            return 0;
+        return header->count;
+    }
+};
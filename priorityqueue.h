@@ -1,8 +1,12 @@
 ///@author Krenar Banushi
 ///@date April 11, 2023
 ///@brief This header provides the priorityqueue class and definitions.  A priorityqueue will store values in increasing order by priority. 
-///       This implementation is templated to allow for any data type, but priorities must be integers.
+///       This implementation is templated to allow for any data type and any priority type ordered by a comparator,
+///       by default integer priorities in increasing order.  Pass std::greater<Priority> to dequeue the largest first.
+///       The BST is kept AVL balanced so every operation stays O(logn) even for sorted priorities.
 ///       Some main functions are enqueue, dequeue, begin, next, size, assignment operator, equality operator, toString
+///       save and load write and restore a checksummed binary snapshot for checkpoint and restart
+///       Standard bidirectional const_iterators (begin/end, cbegin/cend, rbegin/rend) make it a std::ranges::range
 /// Assignment details and provided code are created and
 /// owned by Adam T Koehler, PhD - Copyright 2023.
 /// University of Illinois Chicago - CS 251 Spring 2023
@@ -12,45 +16,274 @@
 #include <iostream>
 #include <sstream>
 #include <set>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "priorityqueuecommon.h"
 
 using namespace std;
 
-template<typename T>
+// Snapshot returned by priorityqueue::stats.  The shape fields are always filled in, the counters only when the
+// queue is instantiated with Stats = true and are otherwise 0.  Counters add up over the life of the queue.
+struct priorityqueuestats {
+    int size = 0;  // # of elements
+    int uniqueNodes = 0;  // # of tree nodes, one per distinct priority
+    int height = 0;  // height of the tree, stays within about 1.44 log2(uniqueNodes) while AVL balanced
+    int longestList = 0;  // # of nodes in the longest duplicate list
+    size_t bytesAllocated = 0;  // bytes of node storage held by the queue
+    long long insertions = 0;  // # of lists inserted with a tree descent, one per enqueue
+    long long descentSteps = 0;  // # of tree nodes compared during those descents
+    long long listSteps = 0;  // # of duplicate list nodes stepped over to reach a later node of the list
+    long long spineSteps = 0;  // # of left child steps taken to find the leftmost node of a subtree
+};
+
+// Converts priorities and values to bytes for priorityqueue::save and load.  Trivially copyable types are copied
+// byte for byte and strings are written after their length.  Specialize it with the same two functions for any other
+// type; read returns false when the bytes left are not a valid encoding.
+template<typename FIELD>
+struct priorityqueueserializer {
+    static_assert(is_trivially_copyable<FIELD>::value, "specialize priorityqueueserializer to save and load this type");
+
+    static void write(string& out, const FIELD& field){
+        out.append(reinterpret_cast<const char*>(&field), sizeof(FIELD));
+    }
+
+    static bool read(string_view& in, FIELD& field){
+        if (in.size() < sizeof(FIELD))
+            return false;
+        memcpy(&field, in.data(), sizeof(FIELD));
+        in.remove_prefix(sizeof(FIELD));
+        return true;
+    }
+};
+
+template<>
+struct priorityqueueserializer<string> {
+    static void write(string& out, const string& field){
+        priorityqueueserializer<uint64_t>::write(out, field.size());
+        out.append(field);
+    }
+
+    static bool read(string_view& in, string& field){
+        uint64_t length;
+        if (!priorityqueueserializer<uint64_t>::read(in, length) || in.size() < length)
+            return false;
+        field.assign(in.data(), length);
+        in.remove_prefix(length);
+        return true;
+    }
+};
+
+// Stats = true counts enqueue descents, duplicate list steps and leftmost spine steps for stats().  The default
+// compiles the increments out; the counters stay a member either way so the layout never depends on it.
+template<typename T, typename Priority = int, typename Compare = std::less<Priority>, bool Stats = false>
 class priorityqueue {
 private:
+    using PriorityArg = priorityqueuearg<Priority>;
+
     struct NODE {
-        int priority;  // used to build BST
+        Priority priority;  // used to build BST
         T value;  // stored data for the p-queue
         bool dup;  // marked true when there are duplicate priorities
-        NODE* parent;  // links back to parent
+        int length;  // # of nodes in the duplicate list, kept up to date on list heads
+        NODE* parent;  // links back to parent, or to the previous node in the list for duplicates
         NODE* link;  // links to linked list of NODES with duplicate priorities
         NODE* left;  // links to left child
         NODE* right;  // links to right child
+        int height;  // height of the subtree rooted at this node, used to keep the BST balanced
+        int count;  // # of elements in the subtree rooted at this node, counting every node of each duplicate list
+        NODE* tail;  // last node in the duplicate list, the node itself when it has no duplicates
+
+        /// @brief Construct a detached node, building its value in place from the given arguments
+        /// @param priority priority of the node
+        /// @param args arguments forwarded to the constructor of T
+        template<typename... Args>
+        NODE(PriorityArg priority, Args&&... args)
+            : priority(priority), value(std::forward<Args>(args)...), dup(false), length(1), parent(nullptr),
+              link(nullptr), left(nullptr), right(nullptr), height(1), count(1), tail(this) {}
     };
     NODE* root;  // pointer to root node of the BST
     int size;  // # of elements in the pqueue
-    NODE* curr;  // pointer to next item in pqueue (see begin and next)
+    // Cursor of begin/next.  Range-for over a non-const queue calls begin(), which resets it, so readers sharing a
+    // queue store to it concurrently; relaxed atomics make that well defined at the cost of plain loads and stores
+    atomic<NODE*> curr{nullptr};  // pointer to next item in pqueue (see begin and next)
+    atomic<NODE*> currHead{nullptr};  // tree node whose duplicate list contains curr
+    NODE* first;  // pointer to node with the smallest priority (see peek and dequeue)
+    NODE* last;  // pointer to tree node with the largest priority, its list tail is evicted first (see set_capacity)
+    int maxSize;  // # of elements a bounded queue keeps, 0 when unbounded (see set_capacity)
+    Compare compare;  // orders priorities, the smallest priority by this comparator is dequeued first
 
-    /// @brief Return the second to last node in a list using a pointer to the head of the list
-    /// @param head pointer to head of list
-    /// @return pointer to second to last node in the list
-    NODE* FindSecondToLast(NODE* head){
-        NODE* current = head;
-        while (current->link != nullptr){
-            current = current->link;
+    /// @brief Slab allocator for NODEs.  Memory is requested in slabs that grow with the queue, freed nodes
+    ///        are recycled through a freelist, and every slab is released at once when the queue is cleared.
+    struct POOL {
+        union CELL {
+            CELL* next;  // next free cell, or previous slab when this is the first cell of a slab
+            alignas(NODE) unsigned char storage[sizeof(NODE)];  // raw memory for one NODE
+        };
+        CELL* slabs = nullptr;  // newest slab, older slabs are linked through each slab's first cell
+        CELL* freeList = nullptr;  // cells given back by Deallocate, reused before new cells
+        CELL* bump = nullptr;  // next never used cell in the newest slab
+        CELL* bumpEnd = nullptr;  // one past the last cell of the newest slab
+        int capacity = 0;  // # of cells across all slabs
+
+        /// @brief Allocate a new slab, moving the unused cells of the previous slab onto the freelist
+        /// @param cells number of usable cells in the new slab
+        void AddSlab(int cells){
+            while (bump != bumpEnd){
+                bump->next = freeList;
+                freeList = bump;
+                bump++;
+            }
+
+            CELL* slab = new CELL[cells + 1];
+            slab->next = slabs;
+            slabs = slab;
+            bump = slab + 1;
+            bumpEnd = bump + cells;
+            capacity += cells;
         }
-        return current;
+
+        /// @brief Return uninitialized memory for one NODE, growing the pool only when no cell is free
+        /// @return pointer to memory for one NODE
+        void* Allocate(){
+            if (freeList != nullptr){
+                CELL* cell = freeList;
+                freeList = cell->next;
+                return cell;
+            }
+            if (bump == bumpEnd)
+                AddSlab(min(max(capacity, 32), 65536));
+            return bump++;
+        }
+
+        /// @brief Give the memory of a destroyed NODE back to the pool for reuse
+        /// @param node pointer to memory returned by Allocate
+        void Deallocate(void* node){
+            CELL* cell = static_cast<CELL*>(node);
+            cell->next = freeList;
+            freeList = cell;
+        }
+
+        /// @brief Take over every slab and free cell of another pool, leaving it empty.  Nodes allocated from the
+        ///        other pool then belong to this one
+        /// @param other pool to take slabs from
+        void Adopt(POOL& other){
+            while (other.bump != other.bumpEnd)
+                other.Deallocate(other.bump++);
+
+            if (other.slabs != nullptr){
+                CELL* oldest = other.slabs;
+                while (oldest->next != nullptr)
+                    oldest = oldest->next;
+                oldest->next = slabs;
+                slabs = other.slabs;
+            }
+            if (other.freeList != nullptr){
+                CELL* last = other.freeList;
+                while (last->next != nullptr)
+                    last = last->next;
+                last->next = freeList;
+                freeList = other.freeList;
+            }
+            capacity += other.capacity;
+            other = POOL();
+        }
+
+        /// @brief Free every slab at once, the nodes in them must already be destroyed
+        void Release(){
+            while (slabs != nullptr){
+                CELL* older = slabs->next;
+                delete[] slabs;
+                slabs = older;
+            }
+            freeList = nullptr;
+            bump = nullptr;
+            bumpEnd = nullptr;
+            capacity = 0;
+        }
+    };
+
+    POOL pool;  // storage for every NODE in the tree
+    priorityqueuestats counters;  // hot path counters reported by stats, only counted when Stats is true
+
+    /// @brief Add n to one of the hot path counters when the queue is instantiated with Stats, otherwise do nothing
+    /// @param counter the counter of priorityqueuestats to add to
+    /// @param n amount to add
+    void CountStep(long long priorityqueuestats::* counter, long long n){
+        if constexpr (Stats)
+            counters.*counter += n;
     }
 
-    /// @brief Append node to the end of a list and assign its parent to the head of the list
+    /// @brief Append node to the end of a list in O(1) using the head's tail pointer and assign its parent to the previous node in the list.
+    ///        The head's length grows by the length of the node, so a whole detached list can be appended through its head
     /// @param head pointer to head of list
     /// @param nodeToInsert pointer of node to insert
     void PushBack(NODE* head, NODE* nodeToInsert){
-        NODE* secondToLast = FindSecondToLast(head);
-
-        secondToLast->link = nodeToInsert;
-        nodeToInsert->parent = head;
+        head->tail->link = nodeToInsert;
+        nodeToInsert->parent = head->tail;
         nodeToInsert->dup = true;
+        head->tail = nodeToInsert;
+        head->length += nodeToInsert->length;
+    }
+
+    /// @brief Return true if priority a comes before priority b, integral priorities with the default comparator compile to a single compare
+    /// @param a first priority
+    /// @param b second priority
+    /// @return true if a is ordered before b
+    bool Less(PriorityArg a, PriorityArg b) const {
+        if constexpr (is_integral<Priority>::value && is_same<Compare, std::less<Priority>>::value)
+            return a < b;
+        else
+            return compare(a, b);
+    }
+
+    /// @brief Return true if neither priority comes before the other
+    /// @param a first priority
+    /// @param b second priority
+    /// @return true if a and b are equivalent priorities
+    bool Equivalent(PriorityArg a, PriorityArg b) const {
+        return !Less(a, b) && !Less(b, a);
+    }
+
+    /// @brief Return the head of the duplicate list a node belongs to by searching the tree for its priority
+    /// @param node pointer of node in a duplicate list
+    /// @return pointer to the tree node at the front of the list
+    NODE* FindHead(NODE* node){
+        NODE* current = root;
+        while (!Equivalent(current->priority, node->priority)){
+            if (Less(node->priority, current->priority))
+                current = current->left;
+            else
+                current = current->right;
+        }
+        return current;
+    }
+
+    /// @brief Construct a NODE in memory taken from the pool
+    /// @param priority priority of the node
+    /// @param args arguments forwarded to the constructor of the node's value
+    /// @return pointer to the new node
+    template<typename... Args>
+    NODE* NewNode(PriorityArg priority, Args&&... args){
+        return new (pool.Allocate()) NODE(priority, std::forward<Args>(args)...);
+    }
+
+    /// @brief Destroy a NODE and give its memory back to the pool
+    /// @param node pointer of node to delete
+    void DeleteNode(NODE* node){
+        node->~NODE();
+        pool.Deallocate(node);
     }
 
     /// @brief Return leftmost node in the tree by traversing through node->left
@@ -60,176 +293,1394 @@ private:
         NODE* leftMost = root;
         while (leftMost->left != nullptr){
             leftMost = leftMost->left;
+            CountStep(&priorityqueuestats::spineSteps, 1);
         }
         return leftMost;
     }
 
-    /// @brief Recursively generate string of all node's priority and value followed by an endline 
-    /// @param root pointer to the root of the binary search tree
-    /// @return string of every node's priorities and values split by endlines
-    string InorderPrint(NODE* root){
-        stringstream ss;
-        string line;
-        string temp;
+    /// @brief Return rightmost node in the tree by traversing through node->right
+    /// @param root pointer of node to begin search from
+    /// @return pointer of right most node in the tree
+    static NODE* FindRightMostNode(NODE* root){
+        NODE* rightMost = root;
+        while (rightMost->right != nullptr){
+            rightMost = rightMost->right;
+        }
+        return rightMost;
+    }
 
-        if (root == nullptr){
-            return std::string();
+    /// @brief Return the next tree node in inorder by walking parent pointers
+    /// @param node pointer of current tree node, not a duplicate
+    /// @return pointer to the next tree node, nullptr after the last one
+    static NODE* NextInOrder(NODE* node){
+        if (node->right != nullptr){ //Leftmost node of the right subtree
+            node = node->right;
+            while (node->left != nullptr)
+                node = node->left;
+            return node;
         }
 
-        line += InorderPrint(root->left);
+        //Traverse up parent nodes until the node is a left child
+        while (node->parent != nullptr && node != node->parent->left)
+            node = node->parent;
+        return node->parent;
+    }
 
-        ss << root->priority << " " << root->value;
-        ss >> temp;
-        line += temp;
-        line += " value: ";
-        ss >> temp;
-        line += temp;
-        line += "\n";
+    /// @brief Return the previous tree node in inorder by walking parent pointers
+    /// @param node pointer of current tree node, not a duplicate
+    /// @return pointer to the previous tree node, nullptr before the first one
+    static NODE* PrevInOrder(NODE* node){
+        if (node->left != nullptr)
+            return FindRightMostNode(node->left);
 
-        line += InorderPrint(root->link);
-        line += InorderPrint(root->right);
+        //Traverse up parent nodes until the node is a right child
+        while (node->parent != nullptr && node != node->parent->right)
+            node = node->parent;
+        return node->parent;
+    }
 
-        return line;
+    /// @brief Step an inorder position forward, through the rest of a duplicate list and then to the next tree node
+    /// @param head tree node whose list contains node, moved to the next tree node when the list ends
+    /// @param node current node, set to nullptr after the last node
+    static void Advance(NODE*& head, NODE*& node){
+        if (node->link != nullptr){
+            node = node->link;
+            return;
+        }
+        head = NextInOrder(head);
+        node = head;
+    }
+
+    /// @brief Step an inorder position backward, through the front of a duplicate list and then to the tail of the
+    ///        previous tree node's list
+    /// @param head tree node whose list contains node, moved to the previous tree node when the list ends
+    /// @param node current node, set to nullptr before the first node
+    static void Retreat(NODE*& head, NODE*& node){
+        if (node != head){
+            node = node->parent;
+            return;
+        }
+        head = PrevInOrder(head);
+        node = head == nullptr ? nullptr : head->tail;
+    }
+
+    /// @brief Write one priority or value to an output iterator of chars.  Integers are converted with to_chars and
+    ///        strings are copied directly, any other type is formatted by operator<< through a reused stream
+    /// @param out output iterator to write to
+    /// @param field priority or value to write
+    /// @param ss stream reused for types without a direct conversion
+    /// @return output iterator past the written characters
+    template<typename OutputIt, typename FIELD>
+    static OutputIt WriteField(OutputIt out, const FIELD& field, ostringstream& ss){
+        if constexpr (is_same<FIELD, char>::value){
+            *out++ = field;
+            return out;
+        }
+        else if constexpr (is_integral<FIELD>::value && !is_same<FIELD, bool>::value){
+            char buffer[24];
+            char* end = to_chars(buffer, buffer + sizeof(buffer), field).ptr;
+            return copy(buffer, end, out);
+        }
+        else if constexpr (is_convertible<const FIELD&, string_view>::value){
+            string_view text = field;
+            return copy(text.begin(), text.end(), out);
+        }
+        else{
+            ss.str(string());
+            ss << field;
+            string_view text = ss.view();
+            return copy(text.begin(), text.end(), out);
+        }
     }
 
-    /// @brief Recursively delete tree by starting from the bottom-up
+    /// @brief Destroy tree by starting from the bottom-up, walking parent pointers in postorder instead of recursing.
+    ///        The pool frees the memory afterwards in bulk
     /// @param root pointer to root of tree
     void PostOrderDelete(NODE* root){
-        if (root == nullptr)
-            return;
-        
-        PostOrderDelete(root->left);
-        PostOrderDelete(root->link);
-        PostOrderDelete(root->right);
+        NODE* node = root == nullptr ? nullptr : FirstPostOrder(root);
+
+        while (node != nullptr){
+            NODE* next = NextPostOrder(node);
 
-        delete root;
+            NODE* dup = node;
+            while (dup != nullptr){
+                NODE* nextDup = dup->link;
+                dup->~NODE();
+                dup = nextDup;
+            }
+
+            node = next;
+        }
     }
 
-    /// @brief Recursively deep copy tree into current tree using pointer to root of other tree
-    /// @param root pointer to root of tree to copy
-    void PreOrderCopy(NODE* root) {
-        if (root == nullptr)
-            return;
+    /// @brief Return a detached copy of a single node, overwriting a node from the recycle list before allocating a new one
+    /// @param other pointer of node to copy
+    /// @param recycle list of unused nodes linked through link whose values can be assigned over
+    /// @return pointer to the detached copy
+    NODE* ReuseNode(NODE* other, NODE*& recycle){
+        if (recycle == nullptr)
+            return NewNode(other->priority, other->value);
+
+        NODE* temp = recycle;
+        recycle = recycle->link;
 
-        this->enqueue(root->value, root->priority);
-        PreOrderCopy(root->left);
-        PreOrderCopy(root->link);
-        PreOrderCopy(root->right);
+        temp->priority = other->priority;
+        temp->value = other->value;
+        temp->dup = false;
+        temp->length = 1;
+        temp->parent = nullptr;
+        temp->link = nullptr;
+        temp->left = nullptr;
+        temp->right = nullptr;
+        temp->height = 1;
+        temp->count = 1;
+        temp->tail = temp;
+        return temp;
     }
-    
-    /// @brief Remove node at the front of a duplicate list and reassign the parent node's left and right parameters to the next node in the list
-    /// @param head pointer to head of the list
-    void PopFront(NODE* head){
-        if (head->parent == nullptr){
-            root = head->link;
 
-            root->parent = nullptr;
-            root->dup = false;
-            root->left = head->left;
-            root->right = head->right;
+    /// @brief Return a copy of a tree node together with its duplicate list
+    /// @param other pointer of tree node to copy
+    /// @param parent pointer to parent of the copy
+    /// @param recycle list of unused nodes to reuse before allocating
+    /// @return pointer to the copied tree node
+    NODE* CopyNode(NODE* other, NODE* parent, NODE*& recycle){
+        NODE* temp = ReuseNode(other, recycle);
+        temp->parent = parent;
+        temp->height = other->height;
 
-            UpdateListParents(root);
+        for (NODE* dup = other->link; dup != nullptr; dup = dup->link)
+            PushBack(temp, ReuseNode(dup, recycle));
+        temp->count = other->count;
+
+        return temp;
+    }
+
+    /// @brief Deep copy a tree in one preorder pass that walks parent pointers instead of recursing, so the copy
+    ///        keeps the same balanced shape
+    /// @param other pointer to root of tree to copy
+    /// @param recycle list of unused nodes to reuse before allocating
+    /// @return pointer to root of the copied tree
+    NODE* PreOrderCopy(NODE* other, NODE*& recycle) {
+        if (other == nullptr)
+            return nullptr;
+
+        NODE* copyRoot = CopyNode(other, nullptr, recycle);
+        NODE* copy = copyRoot;
+
+        while (other != nullptr){
+            if (other->left != nullptr && copy->left == nullptr){ //Copy left subtree first
+                copy->left = CopyNode(other->left, copy, recycle);
+                other = other->left;
+                copy = copy->left;
+            }
+            else if (other->right != nullptr && copy->right == nullptr){ //Then right subtree
+                copy->right = CopyNode(other->right, copy, recycle);
+                other = other->right;
+                copy = copy->right;
+            }
+            else{ //Both subtrees done, return to parent
+                other = other->parent;
+                copy = copy->parent;
+            }
         }
-        else{
-            NODE* next = head->link;
 
-            head->parent->left = head->link;
+        return copyRoot;
+    }
+
+    /// @brief Return the first node of a postorder traversal of a subtree
+    /// @param node pointer to root of the subtree
+    /// @return pointer to the deepest leftmost leaf
+    NODE* FirstPostOrder(NODE* node){
+        while (node->left != nullptr || node->right != nullptr)
+            node = node->left != nullptr ? node->left : node->right;
+        return node;
+    }
+
+    /// @brief Return the next node of a postorder traversal using parent pointers
+    /// @param node pointer of current node
+    /// @return pointer to the next node, nullptr after the root
+    NODE* NextPostOrder(NODE* node){
+        NODE* parent = node->parent;
+        if (parent != nullptr && node == parent->left && parent->right != nullptr)
+            return FirstPostOrder(parent->right);
+        return parent;
+    }
 
-            next->dup = false;
-            next->parent = head->parent;
-            next->left = head->left;
-            next->right = head->right;
+    /// @brief Empty the tree without destroying its nodes, returning them in one list linked through link
+    /// @return list of every node that was in the tree
+    NODE* TakeNodes(){
+        NODE* recycle = nullptr;
+        NODE* node = root == nullptr ? nullptr : FirstPostOrder(root);
 
-            UpdateListParents(next);
+        while (node != nullptr){
+            NODE* next = NextPostOrder(node);
+            node->tail->link = recycle;
+            recycle = node;
+            node = next;
         }
 
-        delete head;
+        root = nullptr;
+        curr.store(nullptr, memory_order_relaxed);
+        first = nullptr;
+        last = nullptr;
+        size = 0;
+        return recycle;
     }
 
-    /// @brief Update child nodes' parents to the provided pointer to the head of the list
-    /// @param head pointer to set child nodes in list parent pointer to
-    void UpdateListParents(NODE* head){
-        NODE* current = head->link;
+    /// @brief Remove node at the front of a duplicate list and move the next node in the list into its place in the tree
+    /// @param head pointer to head of the list
+    void PopFront(NODE* head){
+        ReplaceHead(head, head->link);
+        DeleteNode(head);
+    }
 
-        while (current != nullptr){
-            current->parent = head;
-            current = current->link;
+    /// @brief Move a later node of a duplicate list into the head's place in the tree, dropping every node before it
+    ///        from the list and taking them off the counts of every ancestor.  The dropped nodes are not freed
+    /// @param head pointer to head of the list
+    /// @param next pointer of node in the same list to become the new head
+    void ReplaceHead(NODE* head, NODE* next){
+        ReplaceChild(head->parent, head, next);
+
+        next->dup = false;
+        next->length = head->length;
+        for (NODE* dropped = head; dropped != next; dropped = dropped->link){
+            next->length--;
+            CountStep(&priorityqueuestats::listSteps, 1);
         }
+        next->parent = head->parent;
+        next->left = head->left;
+        next->right = head->right;
+        next->height = head->height;
+        next->tail = head->tail;
+
+        if (next->left != nullptr)
+            next->left->parent = next;
+        if (next->right != nullptr)
+            next->right->parent = next;
+        Recount(next);
     }
 
-    /// @brief Delete root or subroot of the binary search tree and update parent pointer to next node
+    /// @brief Delete a node without a left child from the tree, replace it with its right child and rebalance
     /// @param subRoot pointer to root of tree to be deleted
     void DeleteSubRoot(NODE* subRoot){
-        if (subRoot->parent == nullptr){
-            root = subRoot->right;
-            if (root != nullptr)
-                root->parent = nullptr;
-            delete subRoot;
+        NODE* parent = subRoot->parent;
+
+        ReplaceChild(parent, subRoot, subRoot->right);
+        if (subRoot->right != nullptr)
+            subRoot->right->parent = parent;
+
+        Retrace(parent);
+        DeleteNode(subRoot);
+    }
+
+    /// @brief Remove a tree node from the tree and rebalance.  A node with two children has its inorder successor
+    ///        relinked into its place, so no value is moved between nodes.  The node's duplicate list is not touched
+    /// @param node pointer of tree node to remove
+    void RemoveTreeNode(NODE* node){
+        NODE* parent = node->parent;
+
+        if (node->left == nullptr || node->right == nullptr){
+            NODE* child = node->left != nullptr ? node->left : node->right;
+            ReplaceChild(parent, node, child);
+            if (child != nullptr)
+                child->parent = parent;
+            Retrace(parent);
             return;
         }
-        
-        if (subRoot->right != nullptr)
-            subRoot->right->parent = subRoot->parent;
-        subRoot->parent->left = subRoot->right;
-        delete subRoot;
+
+        NODE* successor = FindLeftMostNode(node->right);
+        NODE* lowest = successor; //Lowest node whose subtree changed
+        if (successor != node->right){ //Unlink successor from its parent's left before it takes node's place
+            lowest = successor->parent;
+            lowest->left = successor->right;
+            if (successor->right != nullptr)
+                successor->right->parent = lowest;
+            successor->right = node->right;
+            node->right->parent = successor;
+        }
+        successor->left = node->left;
+        node->left->parent = successor;
+        successor->parent = parent;
+        successor->height = node->height;
+        ReplaceChild(parent, node, successor);
+
+        Retrace(lowest);
+    }
+
+    /// @brief Take any node out of the queue and reset it to a detached node.  A duplicate is unlinked from its list,
+    ///        a head with duplicates hands its place in the tree to the next node of its list and any other node is
+    ///        removed from the tree.  Keeps first up to date, the caller adjusts size
+    /// @param node pointer of node to detach
+    void Detach(NODE* node){
+        if (node->dup){
+            NODE* prev = node->parent;
+            NODE* head = FindHead(prev);
+            prev->link = node->link;
+            if (node->link != nullptr)
+                node->link->parent = prev;
+            else //Removing the tail
+                head->tail = prev;
+            head->length--;
+            Recount(head);
+        }
+        else if (node->link != nullptr){
+            if (first == node)
+                first = node->link;
+            if (last == node)
+                last = node->link;
+            ReplaceHead(node, node->link);
+        }
+        else{
+            if (first == node)
+                first = NextInOrder(node);
+            if (last == node)
+                last = PrevInOrder(node);
+            RemoveTreeNode(node);
+        }
+
+        node->dup = false;
+        node->length = 1;
+        node->parent = nullptr;
+        node->link = nullptr;
+        node->left = nullptr;
+        node->right = nullptr;
+        node->height = 1;
+        node->count = 1;
+        node->tail = node;
+    }
+
+    /// @brief Remove and free the element that would be dequeued last, the tail of the list with the largest priority
+    void EvictLast(){
+        NODE* node = last->tail;
+
+        Detach(node);
+        DeleteNode(node);
+        size--;
+    }
+
+    /// @brief Return true if a new element may enter the queue: the queue is unbounded or not full, or the new priority
+    ///        comes before the element that would be dequeued last, which MakeRoom then evicts
+    /// @param priority priority of the new element
+    /// @return true if the new element may be inserted, false if it must be rejected
+    bool Admits(PriorityArg priority) const {
+        return maxSize == 0 || size < maxSize || Less(priority, last->priority);
+    }
+
+    /// @brief Evict the element that would be dequeued last if a bounded queue is full.  Called after the new node is
+    ///        built, so a value or priority copied from the evicted element is still alive while it is copied
+    void MakeRoom(){
+        if (maxSize > 0 && size >= maxSize)
+            EvictLast();
+    }
+
+    /// @brief Evict elements from the back until a bounded queue is within its capacity
+    void Trim(){
+        while (maxSize > 0 && size > maxSize)
+            EvictLast();
+    }
+
+    /// @brief Insert a new node into the BST by priority, append it to a duplicate list or rebalance the path back to the root
+    /// @param temp pointer of detached node to insert
+    void Insert(NODE* temp){
+        size++;
+        InsertList(temp);
+    }
+
+    /// @brief Insert a detached duplicate list into the BST by priority, splicing it onto the end of an existing list
+    ///        with the same priority or adding its head as a new node and rebalancing the path back to the root.
+    ///        The descent adds the list's length to the count of every node it passes, so the splice onto a duplicate
+    ///        list is O(1) after the descent and never walks back up.  The caller adds the list's nodes to size
+    /// @param temp pointer to head of the detached list
+    void InsertList(NODE* temp){
+        temp->count = temp->length;
+        CountStep(&priorityqueuestats::insertions, 1);
+        if (root == nullptr){
+            root = temp;
+            first = temp;
+            last = temp;
+            return;
+        }
+
+        NODE* current = root;
+        NODE* prev = nullptr;
+        while (current != nullptr){
+            CountStep(&priorityqueuestats::descentSteps, 1);
+            current->count += temp->length;
+            if (Less(temp->priority, current->priority)){ //Traverse left
+                prev = current;
+                current = current->left;
+            }
+            else if (Less(current->priority, temp->priority)){ //Traverse right
+                prev = current;
+                current = current->right;
+            }
+            else{ //Duplicate
+                Splice(current, temp);
+                return;
+            }
+        }
+
+        if (Less(prev->priority, temp->priority))
+            prev->right = temp;
+        else{
+            prev->left = temp;
+        }
+        temp->parent = prev;
+        if (Less(temp->priority, first->priority))
+            first = temp;
+        else if (Less(last->priority, temp->priority))
+            last = temp;
+
+        Retrace(prev);
+    }
+
+    /// @brief Append a whole detached list to the end of another list with the same priority in O(1)
+    /// @param head pointer to head of the list to append to
+    /// @param list pointer to head of the detached list to append
+    void Splice(NODE* head, NODE* list){
+        NODE* tail = list->tail;
+
+        PushBack(head, list);
+        head->tail = tail;
+    }
+
+    /// @brief Build a perfectly balanced BST from list heads sorted by priority, splitting each range at its midpoint
+    /// @param heads pointer to the first head of the range
+    /// @param count number of heads in the range
+    /// @param parent pointer to the parent of the subtree being built
+    /// @return pointer to root of the built subtree
+    NODE* BuildBalanced(NODE** heads, int count, NODE* parent){
+        if (count == 0)
+            return nullptr;
+
+        int mid = count / 2;
+        NODE* node = heads[mid];
+        node->parent = parent;
+        node->left = BuildBalanced(heads, mid, node);
+        node->right = BuildBalanced(heads + mid + 1, count - mid - 1, node);
+        UpdateHeight(node);
+        return node;
+    }
+
+    /// @brief Create a node for every (value, priority) pair of a range and stable sort the nodes by priority, skipping
+    ///        the sort when the range is already sorted
+    /// @param first iterator to the first pair
+    /// @param last iterator past the last pair
+    /// @param sorted filled with the new nodes in the order they should be dequeued
+    template<typename InputIt>
+    void SortedNodes(InputIt first, InputIt last, vector<NODE*>& sorted){
+        if constexpr (is_base_of<forward_iterator_tag, typename iterator_traits<InputIt>::iterator_category>::value){
+            sorted.reserve(distance(first, last));
+            reserve(size + sorted.capacity());
+        }
+        for (; first != last; ++first)
+            sorted.push_back(NewNode(first->second, first->first));
+
+        auto byPriority = [this](NODE* a, NODE* b) { return Less(a->priority, b->priority); };
+        if (!is_sorted(sorted.begin(), sorted.end(), byPriority))
+            stable_sort(sorted.begin(), sorted.end(), byPriority);
+    }
+
+    /// @brief Group runs of equal priorities in a sorted vector of nodes into duplicate lists, keeping their order
+    /// @param sorted nodes sorted by priority, the list heads are moved to the front
+    /// @return number of list heads at the front of sorted
+    int GroupLists(vector<NODE*>& sorted){
+        int heads = 0;
+
+        for (NODE* node : sorted){
+            if (heads > 0 && Equivalent(sorted[heads - 1]->priority, node->priority))
+                PushBack(sorted[heads - 1], node);
+            else
+                sorted[heads++] = node;
+        }
+        return heads;
     }
 
-    /// @brief return true if two binary search trees are equivalent to each other while also traversing duplicate nodes
+    /// @brief Replace the contents of an empty queue with nodes sorted by priority (equal priorities in enqueue order),
+    ///        grouping equal priorities into duplicate lists and building a balanced tree over the list heads
+    /// @param sorted nodes in the order they should be dequeued, reused to hold the list heads
+    void BuildFromSorted(vector<NODE*>& sorted){
+        int heads = GroupLists(sorted);
+
+        root = BuildBalanced(sorted.data(), heads, nullptr);
+        first = heads == 0 ? nullptr : sorted[0];
+        last = heads == 0 ? nullptr : sorted[heads - 1];
+        size = sorted.size();
+    }
+
+    /// @brief Header written in front of the payload by save.  Multi-byte fields are in the byte order of the machine
+    struct SNAPSHOT {
+        char magic[4];  // "BSPQ"
+        uint32_t version;  // format version, load rejects any other
+        uint64_t elements;  // # of elements in the payload
+        uint64_t lists;  // # of duplicate lists in the payload
+        uint64_t bytes;  // # of bytes in the payload
+        uint64_t checksum;  // FNV-1a hash of the payload
+    };
+    static constexpr char SNAPSHOT_MAGIC[4] = {'B', 'S', 'P', 'Q'};
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    /// @brief Hash bytes with 64 bit FNV-1a to detect a damaged snapshot
+    /// @param bytes bytes to hash
+    /// @return hash of the bytes
+    static uint64_t Checksum(string_view bytes){
+        uint64_t hash = 14695981039346656037ull;
+
+        for (unsigned char byte : bytes){
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// @brief Read the duplicate lists of a snapshot payload into new nodes in dequeue order.  Each list is its
+    ///        priority, its length and its values, and the priorities must be strictly increasing
+    /// @param payload bytes of the payload
+    /// @param header header written in front of the payload
+    /// @param sorted filled with the new nodes, the caller deletes them when false is returned
+    /// @return true if the payload holds exactly the lists and elements promised by the header
+    bool ReadLists(string_view payload, const SNAPSHOT& header, vector<NODE*>& sorted){
+        Priority previous{};
+
+        for (uint64_t list = 0; list < header.lists; list++){
+            Priority priority;
+            uint64_t length;
+
+            if (!priorityqueueserializer<Priority>::read(payload, priority)
+                || !priorityqueueserializer<uint64_t>::read(payload, length))
+                return false;
+            if (length == 0 || length > header.elements - sorted.size() || (list > 0 && !Less(previous, priority)))
+                return false;
+
+            for (uint64_t i = 0; i < length; i++){
+                T value;
+                if (!priorityqueueserializer<T>::read(payload, value))
+                    return false;
+                sorted.push_back(NewNode(priority, std::move(value)));
+            }
+            previous = priority;
+        }
+        return payload.empty() && sorted.size() == header.elements;
+    }
+
+    /// @brief Merge detached lists sorted by priority into the tree in one pass.  The tree's list heads are read
+    ///        inorder and merged with the new heads, a new list with the priority of an existing one is spliced onto
+    ///        its end, and a balanced tree is built over the merged heads
+    /// @param heads pointer to the first head of the new lists, sorted by priority with no two equivalent
+    /// @param count number of new list heads
+    /// @param added total number of nodes in the new lists
+    void MergeLists(NODE** heads, int count, int added){
+        vector<NODE*> merged;
+        NODE* node = first;
+        int i = 0;
+
+        merged.reserve(count + size);
+        while (node != nullptr || i < count){
+            NODE* next = node == nullptr ? nullptr : NextInOrder(node);
+
+            if (node == nullptr || (i < count && Less(heads[i]->priority, node->priority)))
+                merged.push_back(heads[i++]);
+            else if (i < count && !Less(node->priority, heads[i]->priority)){
+                Splice(node, heads[i++]);
+                merged.push_back(node);
+                node = next;
+            }
+            else{
+                merged.push_back(node);
+                node = next;
+            }
+        }
+
+        root = BuildBalanced(merged.data(), merged.size(), nullptr);
+        first = merged.empty() ? nullptr : merged.front();
+        last = merged.empty() ? nullptr : merged.back();
+        size += added;
+    }
+
+    /// @brief Add detached lists sorted by priority to the tree.  When there are few lists next to the size of the
+    ///        tree each list is inserted with its own descent, otherwise they are merged in one inorder pass
+    /// @param heads pointer to the first head of the lists, sorted by priority with no two equivalent, each detached
+    ///        from any tree
+    /// @param count number of list heads
+    /// @param added total number of nodes in the lists
+    void AddLists(NODE** heads, int count, int added){
+        int depth = 1;
+        for (int n = size; n > 0; n /= 2)
+            depth++;
+
+        //Merging touches every node of the tree, each descent only touches one path
+        if ((long long)count * depth < 3LL * size + count){
+            for (int i = 0; i < count; i++)
+                InsertList(heads[i]);
+            size += added;
+        }
+        else
+            MergeLists(heads, count, added);
+    }
+
+    /// @brief Take ownership of another queue's nodes and pool, this queue must already be empty
+    /// @param other queue to take nodes from, left empty
+    void MoveFrom(priorityqueue& other){
+        root = other.root;
+        size = other.size;
+        first = other.first;
+        last = other.last;
+        pool = other.pool;
+
+        other.root = nullptr;
+        other.curr.store(nullptr, memory_order_relaxed);
+        other.first = nullptr;
+        other.last = nullptr;
+        other.size = 0;
+        other.pool = POOL();
+    }
+
+    /// @brief Return height of a subtree, 0 for an empty subtree
+    /// @param node pointer to root of subtree
+    /// @return height of the subtree
+    int Height(NODE* node) const {
+        return node == nullptr ? 0 : node->height;
+    }
+
+    /// @brief Return # of elements in a subtree, 0 for an empty subtree
+    /// @param node pointer to root of subtree
+    /// @return # of elements in the subtree, duplicates included
+    static int Count(NODE* node){
+        return node == nullptr ? 0 : node->count;
+    }
+
+    /// @brief Recompute a node's element count from its list length and the counts of its children
+    /// @param node pointer of node to update
+    static void UpdateCount(NODE* node){
+        node->count = node->length + Count(node->left) + Count(node->right);
+    }
+
+    /// @brief Recompute a node's height and element count from its children
+    /// @param node pointer of node to update
+    void UpdateHeight(NODE* node){
+        node->height = 1 + max(Height(node->left), Height(node->right));
+        UpdateCount(node);
+    }
+
+    /// @brief Recompute the element counts of a node and every ancestor after its list grew or shrank
+    /// @param node pointer of lowest tree node whose count changed
+    static void Recount(NODE* node){
+        for (; node != nullptr; node = node->parent)
+            UpdateCount(node);
+    }
+
+    /// @brief Point the parent's child pointer (or root if there is no parent) at a new child
+    /// @param parent pointer to parent node, nullptr if oldChild is the root
+    /// @param oldChild pointer to child being replaced
+    /// @param newChild pointer to replacement child
+    void ReplaceChild(NODE* parent, NODE* oldChild, NODE* newChild){
+        if (parent == nullptr)
+            root = newChild;
+        else if (parent->left == oldChild)
+            parent->left = newChild;
+        else
+            parent->right = newChild;
+    }
+
+    /// @brief Rotate a subtree to the left so its right child becomes the subtree root
+    /// @param node pointer to root of subtree to rotate
+    /// @return pointer to new root of the subtree
+    NODE* RotateLeft(NODE* node){
+        NODE* pivot = node->right;
+
+        node->right = pivot->left;
+        if (pivot->left != nullptr)
+            pivot->left->parent = node;
+
+        pivot->parent = node->parent;
+        ReplaceChild(node->parent, node, pivot);
+
+        pivot->left = node;
+        node->parent = pivot;
+
+        UpdateHeight(node);
+        UpdateHeight(pivot);
+        return pivot;
+    }
+
+    /// @brief Rotate a subtree to the right so its left child becomes the subtree root
+    /// @param node pointer to root of subtree to rotate
+    /// @return pointer to new root of the subtree
+    NODE* RotateRight(NODE* node){
+        NODE* pivot = node->left;
+
+        node->left = pivot->right;
+        if (pivot->right != nullptr)
+            pivot->right->parent = node;
+
+        pivot->parent = node->parent;
+        ReplaceChild(node->parent, node, pivot);
+
+        pivot->right = node;
+        node->parent = pivot;
+
+        UpdateHeight(node);
+        UpdateHeight(pivot);
+        return pivot;
+    }
+
+    /// @brief Restore the AVL property at a node, rotating if its subtrees differ in height by more than one
+    /// @param node pointer to root of subtree to rebalance
+    /// @return pointer to root of the subtree after rebalancing
+    NODE* Rebalance(NODE* node){
+        UpdateHeight(node);
+        int balance = Height(node->left) - Height(node->right);
+
+        if (balance > 1){ //Left heavy
+            if (Height(node->left->left) < Height(node->left->right))
+                RotateLeft(node->left);
+            return RotateRight(node);
+        }
+        if (balance < -1){ //Right heavy
+            if (Height(node->right->right) < Height(node->right->left))
+                RotateRight(node->right);
+            return RotateLeft(node);
+        }
+        return node;
+    }
+
+    /// @brief Walk from a node up towards the root, updating heights and rebalancing ancestors.  Stops rebalancing at the
+    ///        first subtree whose height did not change, since nothing above it can change either, and only updates
+    ///        element counts from there to the root
+    /// @param node pointer of lowest node whose subtree changed
+    /// @return pointer to the root of the tree, nullptr if node was nullptr
+    NODE* Retrace(NODE* node){
+        while (node != nullptr){
+            int oldHeight = node->height;
+
+            node = Rebalance(node);
+            if (node->parent == nullptr)
+                return node;
+            if (node->height == oldHeight)
+                break;
+            node = node->parent;
+        }
+
+        while (node != nullptr && node->parent != nullptr){
+            node = node->parent;
+            UpdateCount(node);
+        }
+        return node;
+    }
+
+    /// @brief Join two detached trees and a detached node between them into one balanced tree.  Every priority in left
+    ///        must come before mid and every priority in right after it.  The taller tree's spine is walked down to a
+    ///        subtree as tall as the shorter tree, mid is put in its place and the path back up is rebalanced
+    /// @param left pointer to root of the tree before mid, may be nullptr
+    /// @param mid pointer of node to join at, keeps its duplicate list
+    /// @param right pointer to root of the tree after mid, may be nullptr
+    /// @return pointer to root of the joined tree
+    NODE* Join(NODE* left, NODE* mid, NODE* right){
+        if (Height(left) > Height(right) + 1){ //Hang mid and right off the right spine of left
+            NODE* node = left;
+            while (Height(node->right) > Height(right) + 1)
+                node = node->right;
+
+            mid->left = node->right;
+            mid->right = right;
+            node->right = mid;
+            mid->parent = node;
+        }
+        else if (Height(right) > Height(left) + 1){ //Hang left and mid off the left spine of right
+            NODE* node = right;
+            while (Height(node->left) > Height(left) + 1)
+                node = node->left;
+
+            mid->right = node->left;
+            mid->left = left;
+            node->left = mid;
+            mid->parent = node;
+        }
+        else{
+            mid->left = left;
+            mid->right = right;
+            mid->parent = nullptr;
+        }
+
+        if (mid->left != nullptr)
+            mid->left->parent = mid;
+        if (mid->right != nullptr)
+            mid->right->parent = mid;
+
+        //mid's subtrees differ in height by at most one, its height from before the join is stale
+        UpdateHeight(mid);
+        return mid->parent == nullptr ? mid : Retrace(mid->parent);
+    }
+
+    /// @brief Split the whole tree into a tree of priorities before the split point and a tree of priorities after it.
+    ///        The search path is walked back up, joining each node and its other subtree onto the matching side
+    /// @param key priority to split at
+    /// @param after true to split after key so key goes left, false to split before key so key goes right
+    /// @param left set to the root of the tree of priorities before the split point
+    /// @param right set to the root of the tree of priorities after the split point
+    void Split(PriorityArg key, bool after, NODE*& left, NODE*& right){
+        auto goesRight = [&](NODE* node){
+            return after ? Less(key, node->priority) : !Less(node->priority, key);
+        };
+        NODE* node = root;
+        NODE* last = nullptr;
+
+        while (node != nullptr){
+            last = node;
+            node = goesRight(node) ? node->left : node->right;
+        }
+
+        left = nullptr;
+        right = nullptr;
+        node = last;
+        while (node != nullptr){
+            NODE* up = node->parent;
+
+            if (goesRight(node)){ //node and its right subtree come after the split point
+                NODE* sub = node->right;
+                if (sub != nullptr)
+                    sub->parent = nullptr;
+                right = Join(right, node, sub);
+            }
+            else{ //node and its left subtree do not
+                NODE* sub = node->left;
+                if (sub != nullptr)
+                    sub->parent = nullptr;
+                left = Join(sub, node, left);
+            }
+            node = up;
+        }
+        root = nullptr;
+    }
+
+    /// @brief Free every node of a detached tree in postorder
+    /// @param tree pointer to root of the tree
+    void DeleteTree(NODE* tree){
+        NODE* node = tree == nullptr ? nullptr : FirstPostOrder(tree);
+
+        while (node != nullptr){
+            NODE* next = NextPostOrder(node);
+
+            NODE* dup = node;
+            while (dup != nullptr){
+                NODE* nextDup = dup->link;
+                DeleteNode(dup);
+                dup = nextDup;
+            }
+
+            node = next;
+        }
+    }
+
+    /// @brief Dequeue from the front while fewer than limit items are taken and the predicate accepts the next item.
+    ///        Values are moved out in one inorder walk, then whole lists are detached by splitting the tree once after
+    ///        the last list taken completely and freed together.  A partly taken list gives up its front nodes and
+    ///        the remaining node moves into the tree
+    /// @param limit maximum number of items to dequeue
+    /// @param pred called with each value and priority in order, dequeueing stops at the first false
+    /// @param out output iterator the dequeued values are moved to
+    /// @return output iterator past the last value written
+    template<typename Predicate, typename OutputIt>
+    OutputIt DequeueFront(int limit, Predicate pred, OutputIt out){
+        NODE* node = first;
+        NODE* lastWhole = nullptr;
+        NODE* partial = nullptr;
+        NODE* partialNext = nullptr;
+        int taken = 0;
+
+        while (node != nullptr){ //Move out values from the front until the limit or predicate stops
+            NODE* dup = node;
+            while (dup != nullptr && taken < limit && pred(static_cast<const T&>(dup->value), static_cast<const Priority&>(dup->priority))){
+                *out++ = std::move(dup->value);
+                dup = dup->link;
+                taken++;
+            }
+            if (dup == nullptr){
+                lastWhole = node;
+                node = NextInOrder(node);
+            }
+            else{
+                if (dup != node){
+                    partial = node;
+                    partialNext = dup;
+                }
+                break;
+            }
+        }
+        if (taken == 0)
+            return out;
+
+        if (lastWhole != nullptr){ //Move out and free every complete list at once
+            NODE* front;
+            NODE* back;
+            Split(lastWhole->priority, true, front, back);
+            root = back;
+            DeleteTree(front);
+        }
+
+        if (partial != nullptr){ //Move out the front of the partly taken list
+            ReplaceHead(partial, partialNext);
+            NODE* dup = partial;
+            while (dup != partialNext){
+                NODE* nextDup = dup->link;
+                DeleteNode(dup);
+                dup = nextDup;
+            }
+        }
+
+        first = root == nullptr ? nullptr : FindLeftMostNode(root);
+        last = root == nullptr ? nullptr : FindRightMostNode(root);
+        size -= taken;
+        return out;
+    }
+
+    /// @brief Return the # of elements whose priority comes before key, also counting those equivalent to key when
+    ///        inclusive is set.  Walks one search path and adds up the counts of the subtrees left of it
+    /// @param key priority to count up to
+    /// @param inclusive true to also count priorities equivalent to key
+    /// @return # of elements before key
+    int CountBefore(PriorityArg key, bool inclusive) const {
+        NODE* node = root;
+        int before = 0;
+
+        while (node != nullptr){
+            if (Less(key, node->priority))
+                node = node->left;
+            else if (Less(node->priority, key)){
+                before += Count(node->left) + node->length;
+                node = node->right;
+            }
+            else{
+                before += Count(node->left) + (inclusive ? node->length : 0);
+                break;
+            }
+        }
+        return before;
+    }
+
+    /// @brief Cut every list with a priority in [lo, hi] out of the tree as one detached tree.  The tree is split
+    ///        before lo and after hi, and the outer trees are joined again at the first node after hi
+    /// @param lo smallest priority to cut
+    /// @param hi largest priority to cut
+    /// @return pointer to root of the detached tree, nullptr if no priority is in range
+    NODE* CutRange(PriorityArg lo, PriorityArg hi){
+        if (root == nullptr || Less(hi, lo))
+            return nullptr;
+
+        NODE* below;
+        NODE* rest;
+        NODE* middle;
+        NODE* above;
+        Split(lo, false, below, rest);
+        root = rest;
+        Split(hi, true, middle, above);
+        root = above;
+
+        if (above != nullptr){ //Take the first node after hi out to join the outer trees at
+            NODE* mid = FindLeftMostNode(above);
+            RemoveTreeNode(mid);
+            root = Join(below, mid, root);
+        }
+        else
+            root = below;
+
+        first = root == nullptr ? nullptr : FindLeftMostNode(root);
+        last = root == nullptr ? nullptr : FindRightMostNode(root);
+        size -= Count(middle);
+        return middle;
+    }
+
+    /// @brief Return true if two tree nodes hold equivalent priorities, equal values and duplicate lists, and have
+    ///        children on the same sides
+    /// @param mine pointer of tree node in the first tree
+    /// @param others pointer of tree node in the second tree
+    /// @return true if the two nodes match
+    bool SameNode(NODE* mine, NODE* others) const {
+        if ((mine->left == nullptr) != (others->left == nullptr) || (mine->right == nullptr) != (others->right == nullptr))
+            return false;
+
+        while (mine != nullptr && others != nullptr){
+            if (!Equivalent(mine->priority, others->priority) || !(mine->value == others->value))
+                return false;
+            mine = mine->link;
+            others = others->link;
+        }
+        return mine == nullptr && others == nullptr;
+    }
+
+    /// @brief return true if two binary search trees are equivalent to each other while also traversing duplicate nodes.
+    ///        Both trees are walked in lockstep preorder through parent pointers, without recursion
     /// @param myRoot pointer to root of first tree to compare
     /// @param otherRoot pointer to root of second tree to compare
     /// @return true if the two trees are equivalent to each other, false otherwise
     bool PreOrderEquivalence(NODE* myRoot, NODE* otherRoot) const {
-        if (myRoot == nullptr && otherRoot == nullptr)
-            return true;
-        else if (myRoot == nullptr || otherRoot == nullptr)
-            return false;
-        else{
-            if (myRoot->priority == otherRoot->priority && myRoot->value == otherRoot->value && 
-            PreOrderEquivalence(myRoot->left, otherRoot->left) && PreOrderEquivalence(myRoot->link, otherRoot->link) && PreOrderEquivalence(myRoot->right, otherRoot->right))
-                return true;
+        if (myRoot == nullptr || otherRoot == nullptr)
+            return myRoot == otherRoot;
+
+        NODE* mine = myRoot;
+        NODE* others = otherRoot;
+        NODE* prev = nullptr;
+
+        while (mine != nullptr){
+            if (prev == mine->parent){ //First visit, compare and go left
+                if (!SameNode(mine, others))
+                    return false;
+                if (mine->left != nullptr){
+                    prev = mine;
+                    mine = mine->left;
+                    others = others->left;
+                    continue;
+                }
+            }
+            if (prev != mine->right && mine->right != nullptr){ //Left subtree done, go right
+                prev = mine;
+                mine = mine->right;
+                others = others->right;
+                continue;
+            }
+
+            prev = mine; //Both subtrees done, return to parent
+            mine = mine->parent;
+            others = others->parent;
+        }
+        return true;
+    }
+
+public:
+    //
+    // const_iterator:
+    //
+    // Bidirectional iterator over the queue in dequeue order.  *it is the
+    // value and it.priority() is its priority.  An iterator only reads the
+    // tree, so any number of readers may iterate at once; it is invalidated
+    // when its element is removed.
+    //
+    // Example usage:
+    //    for (auto it = pq.cbegin(); it != pq.cend(); ++it)
+    //      cout << it.priority() << " value: " << *it << endl;
+    //
+    class const_iterator {
+    public:
+        using iterator_category = bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : queue(nullptr), head(nullptr), node(nullptr) {}
+
+        reference operator*() const {
+            return node->value;
+        }
+
+        pointer operator->() const {
+            return &node->value;
+        }
+
+        const Priority& priority() const {
+            return node->priority;
+        }
+
+        const_iterator& operator++() {
+            Advance(head, node);
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        const_iterator& operator--() {
+            if (node == nullptr){ //From end to the tail of the last list
+                head = FindRightMostNode(queue->root);
+                node = head->tail;
+            }
             else
-                return false;
+                Retreat(head, node);
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.node == b.node;
         }
+
+    private:
+        friend class priorityqueue;
+
+        const_iterator(const priorityqueue* queue, NODE* head)
+            : queue(queue), head(head), node(head) {}
+
+        const priorityqueue* queue;  // queue being iterated, used to step back from end
+        NODE* head;  // tree node whose duplicate list contains node
+        NODE* node;  // current element, nullptr at end
+    };
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    //
+    // handle:
+    //
+    // Refers to one element, as returned by enqueue and emplace, so it can be
+    // reprioritized or erased later.  Elements are never moved between
+    // nodes, so a handle stays valid until its element is dequeued or
+    // erased, or the queue is cleared or assigned to.  After merge it refers
+    // to the element inside the merged queue.
+    //
+    class handle {
+    public:
+        handle() : node(nullptr) {}
+
+        const T& value() const {
+            return node->value;
+        }
+
+        const Priority& priority() const {
+            return node->priority;
+        }
+
+        explicit operator bool() const {
+            return node != nullptr;
+        }
+
+        friend bool operator==(const handle& a, const handle& b) {
+            return a.node == b.node;
+        }
+
+    private:
+        friend class priorityqueue;
+
+        explicit handle(NODE* node) : node(node) {}
+
+        NODE* node;  // node of the element, nullptr for a default constructed handle
+    };
+
+    //
+    // default constructor:
+    //
+    // Creates an empty priority queue.
+    // O(1)
+    //
+    priorityqueue() : priorityqueue(Compare()) {}
+    
+    //
+    // comparator constructor:
+    //
+    // Creates an empty priority queue ordered by the given comparator.
+    // O(1)
+    //
+    explicit priorityqueue(const Compare& compare) : compare(compare) {
+        root = nullptr;
+        curr.store(nullptr, memory_order_relaxed);
+        first = nullptr;
+        last = nullptr;
+        size = 0;
+        maxSize = 0;
+    }
+
+    //
+    // range constructor:
+    //
+    // Creates a priority queue from a range of (value, priority) pairs, see
+    // assign.
+    // O(n) for a range sorted by priority, O(nlogn) otherwise
+    //
+    template<std::input_iterator InputIt>
+    priorityqueue(InputIt first, InputIt last, const Compare& compare = Compare()) : priorityqueue(compare) {
+        assign(first, last);
+    }
+
+    //
+    // copy constructor:
+    //
+    // Creates a deep copy of the "other" priority queue with the same shape,
+    // allocating all of its nodes in one block.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    priorityqueue(const priorityqueue& other) : priorityqueue(other.compare) {
+        NODE* recycle = nullptr;
+        maxSize = other.maxSize;
+
+        reserve(other.size);
+        root = PreOrderCopy(other.root, recycle);
+        first = root == nullptr ? nullptr : FindLeftMostNode(root);
+        last = root == nullptr ? nullptr : FindRightMostNode(root);
+        size = other.size;
+    }
+
+    //
+    // move constructor:
+    //
+    // Takes over the nodes of the "other" priority queue, leaving it empty.
+    // O(1)
+    //
+    priorityqueue(priorityqueue&& other) noexcept : priorityqueue(other.compare) {
+        maxSize = other.maxSize;
+        MoveFrom(other);
+    }
+
+    //
+    // operator=
+    //
+    // Makes "this" tree a copy of the "other" tree with the same shape.  The
+    // nodes already in "this" tree are reused by assigning over their values,
+    // only missing nodes are allocated and leftover nodes are freed.
+    // Sets all member variables appropriately.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    priorityqueue& operator=(const priorityqueue& other) {
+        if (this == &other)
+            return *this;
+
+        NODE* recycle = TakeNodes();
+        compare = other.compare;
+        maxSize = other.maxSize;
+
+        reserve(other.size);
+        root = PreOrderCopy(other.root, recycle);
+        first = root == nullptr ? nullptr : FindLeftMostNode(root);
+        last = root == nullptr ? nullptr : FindRightMostNode(root);
+        size = other.size;
+
+        while (recycle != nullptr){
+            NODE* next = recycle->link;
+            DeleteNode(recycle);
+            recycle = next;
+        }
+
+        return *this;
+    }
+
+    //
+    // move operator=
+    //
+    // Clears "this" tree and then takes over the nodes of the "other" tree,
+    // leaving "other" empty.
+    // O(n), where n is total number of nodes in "this" custom BST
+    //
+    priorityqueue& operator=(priorityqueue&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        this->clear();
+        compare = other.compare;
+        maxSize = other.maxSize;
+        MoveFrom(other);
+
+        return *this;
+    }
+    
+    //
+    // assign:
+    //
+    // Replaces the contents of the priority queue with a range of
+    // (value, priority) pairs.  Instead of enqueueing one by one, the nodes
+    // are created in one block, sorted by priority only when the range is not
+    // already sorted, and linked directly into a balanced tree.  Equal
+    // priorities keep their order in the range.
+    // O(n) for a range sorted by priority, O(nlogn) otherwise
+    //
+    template<std::input_iterator InputIt>
+    void assign(InputIt first, InputIt last) {
+        clear();
+
+        vector<NODE*> sorted;
+        SortedNodes(first, last, sorted);
+        BuildFromSorted(sorted);
+        Trim();
     }
 
-public:
     //
-    // default constructor:
+    // enqueue_batch:
     //
-    // Creates an empty priority queue.
-    // O(1)
+    // Inserts a range of (value, priority) pairs.  The batch is sorted by
+    // priority and equal priorities are grouped into lists first, so each
+    // list is added to the tree once and keeps the order of the range.  A
+    // batch that is small next to the tree inserts each list with one
+    // descent; a larger batch is merged with the tree in one inorder pass
+    // that rebuilds it balanced.
+    // O(b logb + min(g logn, n + g)), where b is the batch size, g is the
+    // number of distinct priorities in the batch and n is number of unique
+    // nodes in tree
     //
-    priorityqueue() {
-        root = nullptr;
-        curr = nullptr;
-        size = 0;
+    template<std::input_iterator InputIt>
+    void enqueue_batch(InputIt first, InputIt last) {
+        vector<NODE*> sorted;
+        SortedNodes(first, last, sorted);
+        int added = sorted.size();
+        int heads = GroupLists(sorted);
+
+        AddLists(sorted.data(), heads, added);
+        Trim();
     }
-    
+
     //
-    // operator=
+    // merge:
     //
-    // Clears "this" tree and then makes a copy of the "other" tree.
-    // Sets all member variables appropriately.
-    // O(n), where n is total number of nodes in custom BST
+    // Moves every element of the "other" priority queue into this one without
+    // copying or reallocating, leaving "other" empty.  The other queue's node
+    // memory is adopted by this queue and its duplicate lists are spliced onto
+    // the end of lists with the same priority, so elements of this queue come
+    // first among equal priorities.  A small queue is inserted list by list,
+    // a large one is merged inorder and the tree is rebuilt balanced.
+    // O(min(m logn, n + m)) plus O(f) to adopt the other queue's free nodes,
+    // where n and m are the numbers of unique nodes in the two trees
     //
-    priorityqueue& operator=(const priorityqueue& other) {
-        this->clear();
-        
-        PreOrderCopy(other.root);
+    void merge(priorityqueue&& other) {
+        if (this == &other || other.root == nullptr)
+            return;
+        if (root == nullptr){
+            this->clear();
+            MoveFrom(other);
+            Trim();
+            return;
+        }
 
-        return *this;
+        vector<NODE*> heads;
+        for (NODE* node = other.first; node != nullptr; node = other.NextInOrder(node))
+            heads.push_back(node);
+
+        for (NODE* head : heads){
+            head->parent = nullptr;
+            head->left = nullptr;
+            head->right = nullptr;
+            head->height = 1;
+        }
+
+        int added = other.size;
+        pool.Adopt(other.pool);
+        other.root = nullptr;
+        other.curr.store(nullptr, memory_order_relaxed);
+        other.first = nullptr;
+        other.last = nullptr;
+        other.size = 0;
+
+        AddLists(heads.data(), heads.size(), added);
+        Trim();
     }
-    
+
     //
     // clear:
     //
     // Frees the memory associated with the priority queue but is public.
+    // Node memory is released a whole slab at a time, and when T needs no
+    // destructor the tree is not walked at all.
     // O(n), where n is total number of nodes in custom BST
     //
     void clear() {
-        PostOrderDelete(root);
+        if (!is_trivially_destructible<NODE>::value)
+            PostOrderDelete(root);
+        pool.Release();
         root = nullptr;
-        curr = nullptr;
+        curr.store(nullptr, memory_order_relaxed);
+        first = nullptr;
+        last = nullptr;
         size = 0;
     }
     
@@ -247,75 +1698,345 @@ public:
     // enqueue:
     //
     // Inserts the value into the custom BST in the correct location based on
-    // priority.
-    // O(logn + m), where n is number of unique nodes in tree and m is number 
-    // of duplicate priorities
+    // priority, then rebalances the path back to the root so the tree stays
+    // AVL balanced even for sorted or reverse sorted priorities.  Duplicate
+    // priorities are appended to the end of their list through its tail.
+    // Returns a handle to the new element, which may be ignored.  A full
+    // bounded queue first evicts its worst element, or rejects the value
+    // without allocating and returns an empty handle if the value would be
+    // the worst, see set_capacity.
+    // O(logn), where n is number of unique nodes in tree
     //
-    void enqueue(T value, int priority) {
-        NODE* temp = new NODE;
-        temp->left = nullptr;
-        temp->right = nullptr;
-        temp->dup = false;
-        temp->link = nullptr;
-        temp->value = value;
-        temp->priority = priority;  
-        temp->parent = nullptr;
+    handle enqueue(const T& value, PriorityArg priority) {
+        if (!Admits(priority))
+            return handle();
+        NODE* node = NewNode(priority, value);
+        MakeRoom();
+        Insert(node);
+        return handle(node);
+    }
 
-        size++;
-        if (root == nullptr){
-            root = temp;
+    //
+    // enqueue (move):
+    //
+    // Same as enqueue, but moves the value into the queue instead of copying it.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    handle enqueue(T&& value, PriorityArg priority) {
+        if (!Admits(priority))
+            return handle();
+        NODE* node = NewNode(priority, std::move(value));
+        MakeRoom();
+        Insert(node);
+        return handle(node);
+    }
+
+    //
+    // emplace:
+    //
+    // Same as enqueue, but constructs the value in place inside the queue
+    // from the given constructor arguments.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    template<typename... Args>
+    handle emplace(PriorityArg priority, Args&&... args) {
+        if (!Admits(priority))
+            return handle();
+        NODE* node = NewNode(priority, std::forward<Args>(args)...);
+        MakeRoom();
+        Insert(node);
+        return handle(node);
+    }
+
+    //
+    // update_priority:
+    //
+    // Changes the priority of the element referred to by the handle.  The
+    // element is taken out of its duplicate list or the tree and inserted
+    // again at the end of the list for its new priority, as if it had just
+    // been enqueued.  An equivalent priority keeps its place in line.  The
+    // handle stays valid.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    void update_priority(handle h, PriorityArg priority) {
+        NODE* node = h.node;
+
+        if (Equivalent(node->priority, priority)){
+            node->priority = priority;
             return;
         }
 
-        NODE* current = root;
-        NODE* prev = nullptr;
-        while (current != nullptr){
-            if (priority < current->priority){ //Traverse left
-                prev = current;
-                current = current->left;
-            }
-            else if (priority > current->priority){ //Traverse right
-                prev = current;
-                current = current->right;
-            }
-            else{ //Duplicate
-                PushBack(current, temp);
-                return;
-            }
-        }
+        Detach(node);
+        node->priority = priority;
+        InsertList(node);
+    }
 
-        if (prev->priority < temp->priority) 
-            prev->right = temp;
-        else{
-            prev->left = temp;
-        }
-        temp->parent = prev;
+    //
+    // erase:
+    //
+    // Removes the element referred to by the handle from the priority queue,
+    // wherever it is in line, and invalidates the handle.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    void erase(handle h) {
+        Detach(h.node);
+        DeleteNode(h.node);
+        size--;
     }
 
     //
     // dequeue:
     //
     // returns the value of the next element in the priority queue and removes
-    // the element from the priority queue.
-    // O(logn + m), where n is number of unique nodes in tree and m is number 
-    // of duplicate priorities
+    // the element from the priority queue.  The cached smallest node is
+    // removed directly and replaced by its inorder successor, and its value
+    // is moved out rather than copied.
+    // O(logn), where n is number of unique nodes in tree
     //
     T dequeue() {
         if (root == nullptr)
             return T{};
         
-        NODE* current = FindLeftMostNode(root);
-        T valueOut = current->value;
+        NODE* current = first;
+        T valueOut = std::move(current->value);
 
-        if (current->link != nullptr)
+        if (current->link != nullptr){
+            first = current->link;
+            if (last == current)
+                last = first;
             PopFront(current);
-        else
+        }
+        else{
+            //The minimum has no left child, so its successor is the leftmost node of its right subtree or its parent
+            first = current->right != nullptr ? FindLeftMostNode(current->right) : current->parent;
+            if (last == current) //The minimum was the only tree node
+                last = nullptr;
             DeleteSubRoot(current);
+        }
         
         size--;
         return valueOut;
     }
     
+    //
+    // dequeue_n:
+    //
+    // Dequeues up to k elements at once, moving their values to the output
+    // iterator in dequeue order.  The inorder sequence is walked once from
+    // the front, every complete duplicate list is cut off the tree with one
+    // split and all of their nodes are freed together.  Returns the output
+    // iterator past the last value written.
+    // O(k + logn), where n is number of unique nodes in tree
+    //
+    template<typename OutputIt>
+    OutputIt dequeue_n(int k, OutputIt out) {
+        return DequeueFront(k, [](const T&, const Priority&) { return true; }, out);
+    }
+
+    //
+    // dequeue_while:
+    //
+    // Dequeues elements from the front as long as pred(value, priority)
+    // returns true, moving their values to the output iterator in dequeue
+    // order, see dequeue_n.  Returns the output iterator past the last value
+    // written.
+    // O(k + logn), where k is the number of elements dequeued and n is number
+    // of unique nodes in tree
+    //
+    template<typename Predicate, typename OutputIt>
+    OutputIt dequeue_while(Predicate pred, OutputIt out) {
+        return DequeueFront(size, pred, out);
+    }
+
+    //
+    // lower_bound, upper_bound:
+    //
+    // Return an iterator to the first element whose priority does not come
+    // before (lower_bound) or comes after (upper_bound) the given priority,
+    // or end() if there is none.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    const_iterator lower_bound(PriorityArg priority) const {
+        NODE* node = root;
+        NODE* bound = nullptr;
+
+        while (node != nullptr){
+            if (Less(node->priority, priority))
+                node = node->right;
+            else{
+                bound = node;
+                node = node->left;
+            }
+        }
+        return const_iterator(this, bound);
+    }
+
+    const_iterator upper_bound(PriorityArg priority) const {
+        NODE* node = root;
+        NODE* bound = nullptr;
+
+        while (node != nullptr){
+            if (Less(priority, node->priority)){
+                bound = node;
+                node = node->left;
+            }
+            else
+                node = node->right;
+        }
+        return const_iterator(this, bound);
+    }
+
+    //
+    // count_range:
+    //
+    // Returns the # of elements with a priority in [lo, hi], duplicates
+    // included, from the element counts kept on every subtree.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    int count_range(PriorityArg lo, PriorityArg hi) const {
+        if (Less(hi, lo))
+            return 0;
+        return CountBefore(hi, true) - CountBefore(lo, false);
+    }
+
+    //
+    // nth:
+    //
+    // Returns an iterator to the element at zero based position k in dequeue
+    // order, or end() if k is not in [0, Size()).  The list holding it, and
+    // so its priority, is found from the element counts kept on every
+    // subtree; inside a duplicate list the element is reached from the
+    // nearer end of the list.
+    // O(logn + min(j, m - j)), where n is number of unique nodes in tree and
+    // j is the position within a duplicate list of m nodes
+    //
+    const_iterator nth(int k) const {
+        if (k < 0 || k >= size)
+            return end();
+
+        NODE* node = root;
+        while (true){
+            if (k < Count(node->left))
+                node = node->left;
+            else{
+                k -= Count(node->left);
+                if (k < node->length)
+                    break;
+                k -= node->length;
+                node = node->right;
+            }
+        }
+
+        const_iterator it(this, node);
+        if (k <= node->length / 2){
+            while (k-- > 0)
+                it.node = it.node->link;
+        }
+        else{
+            it.node = node->tail;
+            for (int back = node->length - 1 - k; back > 0; back--)
+                it.node = it.node->parent;
+        }
+        return it;
+    }
+
+    //
+    // rank:
+    //
+    // Returns the # of elements whose priority comes before the given
+    // priority, which is the position the first element with that priority
+    // has, or would have, in dequeue order.
+    // O(logn), where n is number of unique nodes in tree
+    //
+    int rank(PriorityArg priority) const {
+        return CountBefore(priority, false);
+    }
+
+    //
+    // erase_range:
+    //
+    // Removes every element with a priority in [lo, hi].  The matching
+    // lists are split off the tree as a whole and freed together.  Returns
+    // the # of elements removed.
+    // O(k + logn), where k is the number of elements removed and n is number
+    // of unique nodes in tree
+    //
+    int erase_range(PriorityArg lo, PriorityArg hi) {
+        NODE* middle = CutRange(lo, hi);
+        int erased = Count(middle);
+
+        DeleteTree(middle);
+        return erased;
+    }
+
+    //
+    // extract_range:
+    //
+    // Removes every element with a priority in [lo, hi] like erase_range,
+    // moving their values to the output iterator in dequeue order.  Returns
+    // the output iterator past the last value written.
+    // O(k + logn), where k is the number of elements removed and n is number
+    // of unique nodes in tree
+    //
+    template<typename OutputIt>
+    OutputIt extract_range(PriorityArg lo, PriorityArg hi, OutputIt out) {
+        NODE* middle = CutRange(lo, hi);
+
+        for (NODE* node = middle == nullptr ? nullptr : FindLeftMostNode(middle); node != nullptr; node = NextInOrder(node)){
+            for (NODE* dup = node; dup != nullptr; dup = dup->link)
+                *out++ = std::move(dup->value);
+        }
+        DeleteTree(middle);
+        return out;
+    }
+
+    //
+    // set_capacity:
+    //
+    // Bounds the queue to keep at most k elements, the k that would be
+    // dequeued first; 0 removes the bound.  Elements beyond the bound are
+    // evicted from the back right away.  Once the queue is full, enqueue
+    // evicts the element that would be dequeued last to make room for a
+    // better one and rejects any element that would not come before it, and
+    // enqueue_batch, merge and assign evict down to the bound afterwards.
+    // O(e logn), where e is the number of elements evicted and n is number
+    // of unique nodes in tree
+    //
+    void set_capacity(int k) {
+        maxSize = max(k, 0);
+        Trim();
+    }
+
+    //
+    // capacity:
+    //
+    // Returns the bound set by set_capacity, 0 if the queue is unbounded.
+    // O(1)
+    //
+    int capacity() const {
+        return maxSize;
+    }
+
+    //
+    // stats:
+    //
+    // Returns a snapshot of the shape of the tree and, when instantiated with
+    // Stats, of the hot path counters, see priorityqueuestats.
+    // Only reads the queue.
+    // O(u), where u is number of unique nodes in tree
+    //
+    priorityqueuestats stats() const {
+        priorityqueuestats snapshot = counters;
+        snapshot.size = size;
+        snapshot.height = Height(root);
+        snapshot.bytesAllocated = size_t(pool.capacity) * sizeof(typename POOL::CELL);
+        for (NODE* node = first; node != nullptr; node = NextInOrder(node)){
+            snapshot.uniqueNodes++;
+            snapshot.longestList = max(snapshot.longestList, node->length);
+        }
+        return snapshot;
+    }
+
     //
     // Size:
     //
@@ -332,9 +2053,12 @@ public:
     // Resets internal state for an inorder traversal.  After the
     // call to begin(), the internal state denotes the first inorder
     // node; this ensure that first call to next() function returns
-    // the first inorder node value.
+    // the first inorder node value.  Also returns an iterator to the
+    // first element, so range-for works on a non-const queue.  The internal
+    // state is a relaxed atomic, so readers sharing a queue may call begin
+    // concurrently; each reader's traversal uses only its iterator.
     //
-    // O(logn), where n is number of unique nodes in tree
+    // O(1), the node with the smallest priority is cached
     //
     // Example usage:
     //    pq.begin();
@@ -342,10 +2066,56 @@ public:
     //      cout << priority << " value: " << value << endl;
     //    }
     //    cout << priority << " value: " << value << endl;
-    void begin() {
-        if (root == nullptr)
-            return;
-        curr = FindLeftMostNode(root);
+    const_iterator begin() {
+        curr.store(first, memory_order_relaxed);
+        currHead.store(first, memory_order_relaxed);
+        return const_iterator(this, first);
+    }
+
+    //
+    // begin (const), cbegin, end, cend:
+    //
+    // Return iterators to the first element and past the last element in
+    // dequeue order, without touching any internal state.
+    // O(1)
+    //
+    const_iterator begin() const {
+        return const_iterator(this, first);
+    }
+
+    const_iterator cbegin() const {
+        return const_iterator(this, first);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, nullptr);
+    }
+
+    const_iterator cend() const {
+        return const_iterator(this, nullptr);
+    }
+
+    //
+    // rbegin, crbegin, rend, crend:
+    //
+    // Return reverse iterators, from the last element in dequeue order back
+    // to the first.  Use prev(it.base()).priority() for an element's priority.
+    // O(1), stepping back from the end finds the last node in O(logn)
+    //
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator crbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crend() const {
+        return const_reverse_iterator(begin());
     }
     
     //
@@ -360,7 +2130,7 @@ public:
     // meaning no more values/priorities are available.  This is the end of the
     // inorder traversal.
     //
-    // O(logn), where n is the number of unique nodes in tree
+    // O(logn) worst case, O(1) amortized over a whole traversal
     //
     // Example usage:
     //    pq.begin();
@@ -369,37 +2139,64 @@ public:
     //    }
     //    cout << priority << " value: " << value << endl;
     //
-    bool next(T& value, int &priority) {
-        if (curr == nullptr)
+    bool next(T& value, Priority &priority) {
+        NODE* node = curr.load(memory_order_relaxed);
+        NODE* head = currHead.load(memory_order_relaxed);
+
+        if (node == nullptr)
             return false;
 
-        value = curr->value;
-        priority = curr->priority;
+        value = node->value;
+        priority = node->priority;
 
-        if (curr->link != nullptr){
-            curr = curr->link;
-            return true;
-        }
-        
-        if (curr->dup) //If down duplicate list
-            curr = curr->parent; //Return to front of list
-        
-        if (curr->right != nullptr)
-                curr = FindLeftMostNode(curr->right);
-        else if (curr->parent != nullptr){
-            //Traverse up parent nodes until the parent node is a left child
-            while (curr->parent != nullptr && curr != curr->parent->left)
-                curr = curr->parent;
-            curr = curr->parent;
-        }
-        else
-            curr = nullptr;
+        Advance(head, node);
+        curr.store(node, memory_order_relaxed);
+        currHead.store(head, memory_order_relaxed);
 
-        if (curr == nullptr)
+        if (node == nullptr)
             return false;
         return true;
     }
     
+    //
+    // format_to:
+    //
+    // Writes the entire priority queue, in order, to an output iterator of
+    // chars in the toString format.  Each entry is written exactly once in a
+    // single pass over the tree, with no intermediate strings for integer and
+    // string priorities and values.  Returns the iterator past the output.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    template<typename OutputIt>
+    OutputIt format_to(OutputIt out) {
+        ostringstream ss;
+        const string_view separator = " value: ";
+
+        if (root == nullptr)
+            return out;
+
+        for (NODE* node = first; node != nullptr; node = NextInOrder(node)){
+            for (NODE* dup = node; dup != nullptr; dup = dup->link){
+                out = WriteField(out, dup->priority, ss);
+                out = copy(separator.begin(), separator.end(), out);
+                out = WriteField(out, dup->value, ss);
+                *out++ = '\n';
+            }
+        }
+        return out;
+    }
+
+    //
+    // print:
+    //
+    // Writes the entire priority queue, in order, to an output stream in the
+    // toString format, see format_to.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    void print(ostream& out) {
+        format_to(ostreambuf_iterator<char>(out));
+    }
+
     //
     // toString:
     //
@@ -408,24 +2205,129 @@ public:
     //  2 value: Jen
     //  2 value: Sven
     //  3 value: Gwen"
+    // The string's buffer is reserved up front and filled by format_to.
+    // O(n), where n is total number of nodes in custom BST
     //
     string toString() {
-        return InorderPrint(root);
+        string line;
+
+        line.reserve(size_t(size) * 16);
+        format_to(back_inserter(line));
+        return line;
     }
     
+    //
+    // save:
+    //
+    // Writes a binary snapshot of the priority queue that load can restore.
+    // Every duplicate list is written in dequeue order as its priority, its
+    // length and its values, after a header holding a magic number, the
+    // format version, the counts and an FNV-1a checksum of the payload.
+    // Priorities and values are encoded by priorityqueueserializer, which
+    // copies trivially copyable types byte for byte.  The snapshot uses the
+    // byte order of the machine.  Returns false if the stream fails.
+    // O(n), where n is total number of nodes in custom BST
+    //
+    bool save(ostream& out) const {
+        SNAPSHOT header{};
+        string payload;
+
+        payload.reserve(size_t(size) * (sizeof(T) + sizeof(Priority)));
+        for (NODE* node = first; node != nullptr; node = NextInOrder(node)){
+            priorityqueueserializer<Priority>::write(payload, node->priority);
+            priorityqueueserializer<uint64_t>::write(payload, node->length);
+            for (NODE* dup = node; dup != nullptr; dup = dup->link)
+                priorityqueueserializer<T>::write(payload, dup->value);
+            header.lists++;
+        }
+
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.elements = size;
+        header.bytes = payload.size();
+        header.checksum = Checksum(payload);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), payload.size());
+        return out.good();
+    }
+
+    //
+    // load:
+    //
+    // Replaces the contents of the priority queue with a snapshot written by
+    // save.  The lists are read in sorted order, so the balanced tree is
+    // built over them directly without any comparisons beyond checking the
+    // order.  Returns false and leaves the queue unchanged if the stream
+    // ends early or the snapshot has the wrong magic number, version or
+    // checksum, or does not decode.  A bounded queue keeps its capacity and
+    // trims the loaded elements to it.  T must be default constructible.
+    // O(n), where n is total number of nodes in the snapshot
+    //
+    bool load(istream& in) {
+        SNAPSHOT header;
+        string payload;
+        char chunk[65536];
+
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION
+            || header.elements > uint64_t(numeric_limits<int>::max()) || header.lists > header.elements)
+            return false;
+
+        //Read in chunks, so a damaged byte count cannot allocate more than the stream holds
+        while (payload.size() < header.bytes){
+            size_t want = min<uint64_t>(sizeof(chunk), header.bytes - payload.size());
+            if (!in.read(chunk, want))
+                return false;
+            payload.append(chunk, want);
+        }
+        if (Checksum(payload) != header.checksum)
+            return false;
+
+        priorityqueue loaded(compare);
+        vector<NODE*> sorted;
+
+        sorted.reserve(min(header.elements, header.bytes));
+        loaded.reserve(min(header.elements, header.bytes));
+        if (!loaded.ReadLists(payload, header, sorted)){
+            for (NODE* node : sorted)
+                loaded.DeleteNode(node);
+            return false;
+        }
+        loaded.BuildFromSorted(sorted);
+
+        clear();
+        MoveFrom(loaded);
+        Trim();
+        return true;
+    }
+
     //
     // peek:
     //
     // returns the value of the next element in the priority queue but does not
     // remove the item from the priority queue.
-    // O(logn + m), where n is number of unique nodes in tree and m is number 
-    // of duplicate priorities
+    // O(1), the node with the smallest priority is cached
     //
     T peek() {
         if (root == nullptr)
             return T{};
         
-        return FindLeftMostNode(root)->value;
+        return first->value;
+    }
+
+    //
+    // peekPriority:
+    //
+    // returns the priority of the next element in the priority queue, or a
+    // default constructed priority if the queue is empty.
+    // O(1), the node with the smallest priority is cached
+    //
+    Priority peekPriority() {
+        if (root == nullptr)
+            return Priority{};
+
+        return first->priority;
     }
     
     //
@@ -439,6 +2341,19 @@ public:
         return PreOrderEquivalence(root, other.root);
     }
     
+    //
+    // reserve:
+    //
+    // Preallocates node storage so that the queue can hold n elements without
+    // requesting more memory.  Dequeued nodes are recycled, so a queue that
+    // stays within its reserved size never touches the heap.
+    // O(1) when enough storage is already available, otherwise O(n)
+    //
+    void reserve(int n) {
+        if (n > pool.capacity)
+            pool.AddSlab(n - pool.capacity);
+    }
+
     //
     // getRoot - Do not edit/change!
     //
@@ -0,0 +1,90 @@
+///@brief This header provides what the priority queue headers share: the type priorities are passed as, and the d-ary
+///       heap ordering of heappriorityqueue and mappedpriorityqueue, whose heaps differ only in where the entries live.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+// Scalar priorities such as int are passed by value, anything larger by const reference
+template<typename Priority>
+using priorityqueuearg = typename conditional<is_scalar<Priority>::value, Priority, const Priority&>::type;
+
+// Orders the entries of a d-ary heap kept in one contiguous array: the smallest priority by Compare first, and equal
+// priorities in the order of their seq field.  The array is passed to every call, so the same ordering serves a heap
+// in a vector or in a mapped file.  ENTRY is any struct with priority and seq fields.
+template<typename Priority, typename Compare, int Arity>
+struct heaporder {
+    static_assert(Arity >= 2, "a heap needs at least two children per node");
+
+    Compare compare;  // orders priorities
+
+    /// @brief Return true if entry a must be dequeued before entry b
+    /// @param a first entry
+    /// @param b second entry
+    /// @return true if a has a smaller priority, or an equal priority and was enqueued first
+    template<typename ENTRY>
+    bool Before(const ENTRY& a, const ENTRY& b) const {
+        if constexpr (is_integral<Priority>::value && is_same<Compare, std::less<Priority>>::value){
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+        }
+        else{
+            if (compare(a.priority, b.priority))
+                return true;
+            if (compare(b.priority, a.priority))
+                return false;
+        }
+        return a.seq < b.seq;
+    }
+
+    /// @brief Move the entry at index up until its parent comes before it, shifting parents down into the hole
+    /// @param heap first entry of the heap
+    /// @param index position of the entry to sift up
+    template<typename ENTRY>
+    void SiftUp(ENTRY* heap, size_t index) const {
+        ENTRY moving = std::move(heap[index]);
+
+        while (index > 0){
+            size_t parent = (index - 1) / Arity;
+            if (!Before(moving, heap[parent]))
+                break;
+            heap[index] = std::move(heap[parent]);
+            index = parent;
+        }
+        heap[index] = std::move(moving);
+    }
+
+    /// @brief Move the entry at index down until it comes before all of its children, shifting the best child up into the hole
+    /// @param heap first entry of the heap
+    /// @param count # of entries in the heap
+    /// @param index position of the entry to sift down
+    template<typename ENTRY>
+    void SiftDown(ENTRY* heap, size_t count, size_t index) const {
+        ENTRY moving = std::move(heap[index]);
+
+        while (true){
+            size_t child = index * Arity + 1;
+            if (child >= count)
+                break;
+
+            size_t best = child;
+            size_t last = min(child + Arity, count);
+            for (size_t i = child + 1; i < last; i++){
+                if (Before(heap[i], heap[best]))
+                    best = i;
+            }
+
+            if (!Before(heap[best], moving))
+                break;
+            heap[index] = std::move(heap[best]);
+            index = best;
+        }
+        heap[index] = std::move(moving);
+    }
+};
@@ -7,7 +7,15 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <atomic>
+#include <thread>
 #include "priorityqueue.h"
+#include "heappriorityqueue.h"
+#include "concurrentpriorityqueue.h"
+#include "mappedpriorityqueue.h"
+#include "compactpriorityqueue.h"
+#include <cstdio>
+#include <sys/wait.h>
 using namespace std;
 
 /// @brief Test if the constructor initializes datamembers properly to 0
@@ -548,3 +556,1525 @@ TEST(priorityqueue, begin){
     EXPECT_EQ(val, 4);
     EXPECT_EQ(pri, 3);
 }
+
+/// @brief Test if enqueue stays fast and ordered when priorities arrive in ascending order
+///        Additionally uses dequeue, Size, peek
+TEST(priorityqueue, enqueue_sorted_balanced){
+    priorityqueue<int> t;
+    const int n = 100000;
+
+    for (int i = 0; i < n; i++)
+        t.enqueue(i, i);
+
+    EXPECT_EQ(t.Size(), n);
+    for (int i = 0; i < n; i++){
+        EXPECT_EQ(t.peek(), i);
+        EXPECT_EQ(t.dequeue(), i);
+    }
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if enqueue stays fast and ordered when priorities arrive in descending order with duplicates
+///        Additionally uses dequeue, Size, Begin, Next
+TEST(priorityqueue, enqueue_reverse_sorted_duplicates){
+    priorityqueue<int> t;
+    priorityqueue<int> h;
+    int val, pri;
+    const int n = 50000;
+
+    for (int i = n; i > 0; i--){
+        t.enqueue(i, i);
+        t.enqueue(-i, i);
+    }
+
+    h = t;
+    EXPECT_EQ((t == h), true);
+
+    t.begin();
+    for (int i = 1; i <= n; i++){
+        t.next(val, pri);
+        EXPECT_EQ(val, i);
+        EXPECT_EQ(pri, i);
+        t.next(val, pri);
+        EXPECT_EQ(val, -i);
+        EXPECT_EQ(pri, i);
+    }
+
+    for (int i = 1; i <= n; i++){
+        EXPECT_EQ(h.dequeue(), i);
+        EXPECT_EQ(h.dequeue(), -i);
+    }
+    EXPECT_EQ(h.Size(), 0);
+}
+
+/// @brief Test if many duplicate priorities keep FIFO order within each priority
+///        Additionally uses dequeue, Size, Begin, Next
+TEST(priorityqueue, duplicate_heavy_fifo){
+    priorityqueue<int> t;
+    int val, pri;
+    const int n = 100000;
+
+    for (int i = 0; i < n; i++)
+        t.enqueue(i, i % 10);
+
+    t.begin();
+    t.next(val, pri);
+    EXPECT_EQ(val, 0);
+    EXPECT_EQ(pri, 0);
+    t.next(val, pri);
+    EXPECT_EQ(val, 10);
+    EXPECT_EQ(pri, 0);
+
+    for (int p = 0; p < 10; p++){
+        for (int i = p; i < n; i += 10)
+            EXPECT_EQ(t.dequeue(), i);
+    }
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if peek tracks the smallest priority as smaller priorities are enqueued and the front is dequeued
+///        Additionally uses enqueue, dequeue, Size
+TEST(priorityqueue, peek_cached_minimum){
+    priorityqueue<int> t;
+
+    EXPECT_EQ(t.peek(), 0);
+    t.enqueue(50, 5);
+    EXPECT_EQ(t.peek(), 50);
+    t.enqueue(70, 7);
+    EXPECT_EQ(t.peek(), 50);
+    t.enqueue(30, 3);
+    EXPECT_EQ(t.peek(), 30);
+    t.enqueue(31, 3);
+    EXPECT_EQ(t.peek(), 30);
+    t.enqueue(40, 4);
+    EXPECT_EQ(t.dequeue(), 30);
+    EXPECT_EQ(t.peek(), 31);
+    EXPECT_EQ(t.dequeue(), 31);
+    EXPECT_EQ(t.peek(), 40);
+    t.enqueue(10, 1);
+    EXPECT_EQ(t.peek(), 10);
+    EXPECT_EQ(t.dequeue(), 10);
+    EXPECT_EQ(t.dequeue(), 40);
+    EXPECT_EQ(t.dequeue(), 50);
+    EXPECT_EQ(t.dequeue(), 70);
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.peek(), 0);
+}
+
+/// @brief Test if reserved and recycled nodes keep values correct across clear and refill with strings
+///        Additionally uses enqueue, dequeue, Size, clear, peek
+TEST(priorityqueue, reserve_recycle_clear){
+    priorityqueue<string> t;
+
+    t.reserve(1000);
+    for (int round = 0; round < 3; round++){
+        for (int i = 0; i < 1000; i++)
+            t.enqueue("value number " + to_string(i), i % 7);
+        for (int i = 0; i < 500; i++)
+            t.dequeue();
+        for (int i = 0; i < 500; i++)
+            t.enqueue("again " + to_string(i), -1);
+        EXPECT_EQ(t.Size(), 1000);
+        EXPECT_EQ(t.peek(), "again 0");
+        t.clear();
+        EXPECT_EQ(t.Size(), 0);
+        EXPECT_EQ(t.peek(), "");
+    }
+}
+
+/// @brief Test if enqueue with rvalues, emplace and dequeue move strings without losing them
+///        Additionally uses Size, Begin, Next
+TEST(priorityqueue, move_enqueue_emplace){
+    priorityqueue<string> t;
+    string val;
+    int pri;
+    string big(1000, 'x');
+
+    t.enqueue(std::move(big), 2);
+    t.emplace(1, 5, 'a');
+    t.emplace(2, "second two");
+    t.enqueue(string("zero has spaces"), 0);
+
+    EXPECT_EQ(t.Size(), 4);
+    t.begin();
+    t.next(val, pri);
+    EXPECT_EQ(val, "zero has spaces");
+    t.next(val, pri);
+    EXPECT_EQ(val, "aaaaa");
+    EXPECT_EQ(pri, 1);
+
+    EXPECT_EQ(t.dequeue(), "zero has spaces");
+    EXPECT_EQ(t.dequeue(), "aaaaa");
+    EXPECT_EQ(t.dequeue(), string(1000, 'x'));
+    EXPECT_EQ(t.dequeue(), "second two");
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if the copy constructor deep copies and the move constructor and assignment empty the source
+///        Additionally uses enqueue, dequeue, Size, equality operator
+TEST(priorityqueue, copy_move_constructors){
+    priorityqueue<string> t;
+
+    t.enqueue("b", 2);
+    t.enqueue("a", 1);
+    t.enqueue("bb", 2);
+    t.enqueue("c", 3);
+
+    priorityqueue<string> copy(t);
+    EXPECT_EQ((copy == t), true);
+    EXPECT_EQ(copy.dequeue(), "a");
+    EXPECT_EQ(t.Size(), 4);
+    EXPECT_EQ(t.peek(), "a");
+
+    priorityqueue<string> moved(std::move(t));
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.peek(), "");
+    EXPECT_EQ(moved.Size(), 4);
+    EXPECT_EQ(moved.peek(), "a");
+
+    copy = std::move(moved);
+    EXPECT_EQ(moved.Size(), 0);
+    EXPECT_EQ(copy.Size(), 4);
+    EXPECT_EQ(copy.dequeue(), "a");
+    EXPECT_EQ(copy.dequeue(), "b");
+    EXPECT_EQ(copy.dequeue(), "bb");
+    EXPECT_EQ(copy.dequeue(), "c");
+
+    t.enqueue("reused", 7);
+    EXPECT_EQ(t.peek(), "reused");
+}
+
+/// @brief Test if 64 bit priorities keep values ordered beyond the range of int
+///        Additionally uses enqueue, dequeue, Begin, Next
+TEST(priorityqueue, priority_int64){
+    priorityqueue<string, long long> t;
+    string val;
+    long long pri = 0;
+
+    t.enqueue("late", 5000000000LL);
+    t.enqueue("early", 4000000000LL);
+    t.enqueue("now", 0);
+
+    t.begin();
+    t.next(val, pri);
+    EXPECT_EQ(val, "now");
+    t.next(val, pri);
+    EXPECT_EQ(pri, 4000000000LL);
+    EXPECT_EQ(t.dequeue(), "now");
+    EXPECT_EQ(t.dequeue(), "early");
+    EXPECT_EQ(t.dequeue(), "late");
+}
+
+/// @brief Test if std::greater turns the queue into a max priority queue that keeps FIFO order for duplicates
+///        Additionally uses enqueue, dequeue, peek
+TEST(priorityqueue, comparator_greater){
+    priorityqueue<int, int, greater<int>> t;
+
+    t.enqueue(1, 1);
+    t.enqueue(9, 9);
+    t.enqueue(5, 5);
+    t.enqueue(10, 9);
+
+    EXPECT_EQ(t.peek(), 9);
+    EXPECT_EQ(t.dequeue(), 9);
+    EXPECT_EQ(t.dequeue(), 10);
+    EXPECT_EQ(t.dequeue(), 5);
+    EXPECT_EQ(t.dequeue(), 1);
+}
+
+/// @brief Test if a composite priority with a custom comparator orders by deadline and then by tier
+///        Additionally uses enqueue, dequeue, copy constructor, equality operator
+TEST(priorityqueue, comparator_composite){
+    struct ByDeadlineThenTier {
+        bool operator()(const pair<long long, int>& a, const pair<long long, int>& b) const {
+            if (a.first != b.first)
+                return a.first < b.first;
+            return a.second > b.second;
+        }
+    };
+    priorityqueue<string, pair<long long, int>, ByDeadlineThenTier> t;
+
+    t.enqueue("b", {20, 1});
+    t.enqueue("a", {10, 1});
+    t.enqueue("c", {20, 2});
+    t.enqueue("d", {20, 2});
+
+    priorityqueue<string, pair<long long, int>, ByDeadlineThenTier> h(t);
+    EXPECT_EQ((h == t), true);
+
+    EXPECT_EQ(t.dequeue(), "a");
+    EXPECT_EQ(t.dequeue(), "c");
+    EXPECT_EQ(t.dequeue(), "d");
+    EXPECT_EQ(t.dequeue(), "b");
+    EXPECT_EQ(h.Size(), 4);
+}
+
+/// @brief Test if a comparator without a default constructor or copy assignment orders the queue
+///        Additionally uses enqueue, dequeue, range constructor
+TEST(priorityqueue, comparator_stateful){
+    struct ByDistance {
+        const int origin;  // priorities closest to origin come first
+        bool operator()(int a, int b) const {
+            return abs(a - origin) < abs(b - origin);
+        }
+    };
+    priorityqueue<string, int, ByDistance> t(ByDistance{10});
+
+    t.enqueue("far", 0);
+    t.enqueue("near", 11);
+    t.enqueue("mid", 15);
+    EXPECT_EQ(t.dequeue(), "near");
+    EXPECT_EQ(t.dequeue(), "mid");
+    EXPECT_EQ(t.dequeue(), "far");
+
+    vector<pair<string, int>> items = {{"a", 1}, {"b", 5}, {"c", 3}};
+    priorityqueue<string, int, ByDistance> r(items.begin(), items.end(), ByDistance{4});
+    EXPECT_EQ(r.dequeue(), "b");
+    EXPECT_EQ(r.dequeue(), "c");
+    EXPECT_EQ(r.dequeue(), "a");
+}
+
+/// @brief Test if the heap backend dequeues in priority order and keeps FIFO order for equal priorities
+///        Additionally uses enqueue, peek, Size
+TEST(heappriorityqueue, dequeue_order_fifo){
+    heappriorityqueue<int> t;
+
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.dequeue(), 0);
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, (i * 7919) % 13);
+
+    EXPECT_EQ(t.Size(), 1000);
+    for (int p = 0; p < 13; p++){
+        for (int i = 0; i < 1000; i++){
+            if ((i * 7919) % 13 == p){
+                EXPECT_EQ(t.peek(), i);
+                EXPECT_EQ(t.dequeue(), i);
+            }
+        }
+    }
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if the binary heap with a max comparator moves strings in and out correctly
+///        Additionally uses enqueue, emplace, dequeue, Size
+TEST(heappriorityqueue, binary_greater_strings){
+    heappriorityqueue<string, long long, greater<long long>, 2> t;
+    string big(100, 'b');
+
+    t.enqueue("low", 1);
+    t.enqueue(std::move(big), 5000000000LL);
+    t.emplace(7, 3, 'c');
+    t.enqueue("also low", 1);
+
+    EXPECT_EQ(t.Size(), 4);
+    EXPECT_EQ(t.dequeue(), string(100, 'b'));
+    EXPECT_EQ(t.dequeue(), "ccc");
+    EXPECT_EQ(t.dequeue(), "low");
+    EXPECT_EQ(t.dequeue(), "also low");
+    EXPECT_EQ(t.dequeue(), "");
+}
+
+/// @brief Test if the range constructor builds a queue from sorted input keeping duplicate input order
+///        Additionally uses dequeue, Size, Begin, Next, equality operator
+TEST(priorityqueue, range_constructor_sorted){
+    vector<pair<int, int>> items;
+    int val, pri;
+
+    for (int i = 0; i < 1000; i++)
+        items.push_back({i, i / 3});
+
+    priorityqueue<int> t(items.begin(), items.end());
+    EXPECT_EQ(t.Size(), 1000);
+
+    t.begin();
+    for (int i = 0; i < 999; i++){
+        EXPECT_EQ(t.next(val, pri), true);
+        EXPECT_EQ(val, i);
+        EXPECT_EQ(pri, i / 3);
+    }
+    EXPECT_EQ(t.next(val, pri), false);
+
+    priorityqueue<int> h(t);
+    EXPECT_EQ((h == t), true);
+    for (int i = 0; i < 1000; i++)
+        EXPECT_EQ(t.dequeue(), i);
+
+    //Two values that are not iterators do not select the range constructor
+    static_assert(!is_constructible<priorityqueue<int>, int, int>::value);
+    static_assert(is_constructible<priorityqueue<int>, vector<pair<int, int>>::iterator, vector<pair<int, int>>::iterator>::value);
+}
+
+/// @brief Test if assign replaces existing contents with unsorted input and keeps duplicates stable
+///        Additionally uses enqueue, dequeue, Size
+TEST(priorityqueue, assign_unsorted){
+    priorityqueue<string> t;
+    vector<pair<string, int>> items = {{"c", 3}, {"a1", 1}, {"b", 2}, {"a2", 1}, {"d", 4}, {"a3", 1}};
+
+    t.enqueue("old", 0);
+    t.assign(items.begin(), items.end());
+
+    EXPECT_EQ(t.Size(), 6);
+    EXPECT_EQ(t.dequeue(), "a1");
+    EXPECT_EQ(t.dequeue(), "a2");
+    EXPECT_EQ(t.dequeue(), "a3");
+    t.enqueue("a4", 1);
+    EXPECT_EQ(t.dequeue(), "a4");
+    EXPECT_EQ(t.dequeue(), "b");
+    EXPECT_EQ(t.dequeue(), "c");
+    EXPECT_EQ(t.dequeue(), "d");
+
+    t.assign(items.begin(), items.begin());
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if assignment into a queue that already holds more or fewer nodes copies exactly the other queue
+///        Additionally uses enqueue, dequeue, Size, equality operator, copy constructor
+TEST(priorityqueue, assignment_reuses_nodes){
+    priorityqueue<string> big;
+    priorityqueue<string> small;
+
+    for (int i = 0; i < 500; i++)
+        big.enqueue("big " + to_string(i), i % 37);
+    for (int i = 0; i < 20; i++)
+        small.enqueue("small " + to_string(i), 20 - i % 5);
+
+    priorityqueue<string> t(big);
+    t = small;
+    EXPECT_EQ(t.Size(), 20);
+    EXPECT_EQ((t == small), true);
+
+    t = big;
+    EXPECT_EQ(t.Size(), 500);
+    EXPECT_EQ((t == big), true);
+
+    t = t;
+    EXPECT_EQ((t == big), true);
+
+    big.clear();
+    for (int i = 0; i < 500; i++){
+        string expected = t.peek();
+        EXPECT_EQ(t.dequeue(), expected);
+    }
+    EXPECT_EQ(t.Size(), 0);
+    t = big;
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.peek(), "");
+}
+
+/// @brief Stress test whole tree operations with ten million items at a single priority, which must not overflow the stack
+///        Additionally uses enqueue, dequeue, Size, copy constructor, equality operator, toString, clear
+TEST(priorityqueue, stress_single_priority){
+    priorityqueue<int> t;
+    const int n = 10000000;
+
+    for (int i = 0; i < n; i++)
+        t.enqueue(i, 7);
+
+    priorityqueue<int> h(t);
+    EXPECT_EQ(h.Size(), n);
+    EXPECT_EQ((h == t), true);
+    size_t length = 0;
+    for (int i = 0; i < n; i++)
+        length += to_string(i).size() + 10;
+    EXPECT_EQ(t.toString().size(), length);
+    EXPECT_EQ(h.dequeue(), 0);
+    EXPECT_EQ((h == t), false);
+    h.clear();
+}
+
+/// @brief Stress test whole tree operations with ten million ascending priorities
+///        Additionally uses enqueue, dequeue, Size, assignment operator, equality operator, Begin, Next
+TEST(priorityqueue, stress_ascending_priorities){
+    priorityqueue<int> t;
+    priorityqueue<int> h;
+    int val = 0, pri = 0;
+    const int n = 10000000;
+
+    for (int i = 0; i < n; i++)
+        t.enqueue(i, i);
+
+    h = t;
+    EXPECT_EQ((h == t), true);
+
+    long long sum = 0;
+    h.begin();
+    while (h.next(val, pri))
+        sum += val;
+    sum += val;
+    EXPECT_EQ(sum, (long long)n * (n - 1) / 2);
+    EXPECT_EQ(h.dequeue(), 0);
+    EXPECT_EQ(t.Size(), n);
+}
+
+/// @brief Test if toString and print write every entry in order without truncating values that contain spaces
+///        Additionally uses enqueue
+TEST(priorityqueue, toString_print_format){
+    priorityqueue<string> t;
+    priorityqueue<double, long long> d;
+    priorityqueue<char> c;
+    stringstream ss;
+
+    EXPECT_EQ(t.toString(), "");
+    t.enqueue("Sven the third", 2);
+    t.enqueue("Ben", 1);
+    t.enqueue("Jen", 2);
+    t.enqueue("Gwen", 3);
+    t.enqueue("negative", -12);
+
+    string expected = "-12 value: negative\n1 value: Ben\n2 value: Sven the third\n2 value: Jen\n3 value: Gwen\n";
+    EXPECT_EQ(t.toString(), expected);
+    t.print(ss);
+    EXPECT_EQ(ss.str(), expected);
+
+    string out;
+    t.format_to(back_inserter(out));
+    EXPECT_EQ(out, expected);
+
+    d.enqueue(3.5, 5000000000LL);
+    d.enqueue(0.25, 1);
+    EXPECT_EQ(d.toString(), "1 value: 0.25\n5000000000 value: 3.5\n");
+
+    c.enqueue('x', 0);
+    EXPECT_EQ(c.toString(), "0 value: x\n");
+}
+
+/// @brief Test if strict mode dequeues in exact priority order with FIFO ties across shards
+///        Additionally uses enqueue, peek, Size, try_dequeue
+TEST(concurrentpriorityqueue, strict_order){
+    concurrentpriorityqueue<int> t(8, true);
+    int val;
+
+    EXPECT_EQ(t.try_dequeue(val), false);
+    EXPECT_EQ(t.dequeue(), 0);
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, (i * 7919) % 13);
+
+    EXPECT_EQ(t.Size(), 1000);
+    EXPECT_EQ(t.peek(), 0);
+    for (int p = 0; p < 13; p++){
+        for (int i = 0; i < 1000; i++){
+            if ((i * 7919) % 13 == p){
+                EXPECT_EQ(t.dequeue(), i);
+            }
+        }
+    }
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if many producers and consumers in relaxed mode deliver every item exactly once
+///        Additionally uses enqueue, try_dequeue, dequeue_wait, Size
+TEST(concurrentpriorityqueue, relaxed_producers_consumers){
+    concurrentpriorityqueue<int> t;
+    const int producers = 4;
+    const int perProducer = 20000;
+    vector<atomic<int>> seen(producers * perProducer);
+    atomic<int> received(0);
+    vector<thread> threads;
+
+    for (int p = 0; p < producers; p++){
+        threads.emplace_back([&t, p](){
+            for (int i = 0; i < perProducer; i++)
+                t.enqueue(p * perProducer + i, i % 100);
+        });
+    }
+    for (int c = 0; c < 4; c++){
+        threads.emplace_back([&](){
+            int val;
+            while (received < producers * perProducer){
+                if (t.dequeue_wait(val, chrono::milliseconds(10))){
+                    seen[val]++;
+                    received++;
+                }
+            }
+        });
+    }
+    for (thread& worker : threads)
+        worker.join();
+
+    EXPECT_EQ(t.Size(), 0);
+    for (int i = 0; i < producers * perProducer; i++)
+        EXPECT_EQ(seen[i].load(), 1);
+}
+
+/// @brief Test if a relaxed queue with a single shard dequeues in exact order and serves several consumers
+///        Additionally uses enqueue, try_dequeue, Size
+TEST(concurrentpriorityqueue, one_shard){
+    concurrentpriorityqueue<int> t(1);
+    int val;
+
+    for (int i = 0; i < 500; i++)
+        t.enqueue(i, (i * 7919) % 11);
+    for (int p = 0; p < 11; p++){
+        for (int i = 0; i < 500; i++){
+            if ((i * 7919) % 11 == p){
+                EXPECT_EQ(t.try_dequeue(val), true);
+                EXPECT_EQ(val, i);
+            }
+        }
+    }
+    EXPECT_EQ(t.try_dequeue(val), false);
+
+    for (int i = 0; i < 20000; i++)
+        t.enqueue(i, i % 50);
+    atomic<int> received(0);
+    vector<thread> consumers;
+    for (int c = 0; c < 4; c++){
+        consumers.emplace_back([&](){
+            int v;
+            while (t.try_dequeue(v))
+                received++;
+        });
+    }
+    for (thread& consumer : consumers)
+        consumer.join();
+    EXPECT_EQ(received, 20000);
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if dequeue_wait times out on an empty queue and wakes up when another thread enqueues
+///        Additionally uses enqueue
+TEST(concurrentpriorityqueue, dequeue_wait){
+    concurrentpriorityqueue<string> t(4);
+    string val;
+
+    auto start = chrono::steady_clock::now();
+    EXPECT_EQ(t.dequeue_wait(val, chrono::milliseconds(20)), false);
+    EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(20));
+
+    thread producer([&t](){
+        this_thread::sleep_for(chrono::milliseconds(20));
+        t.enqueue("wake up", 1);
+    });
+    EXPECT_EQ(t.dequeue_wait(val, chrono::seconds(10)), true);
+    EXPECT_EQ(val, "wake up");
+    producer.join();
+}
+
+/// @brief Test if dequeue_n takes whole duplicate lists and part of the next list in dequeue order
+///        Additionally uses enqueue, dequeue, peek, Size
+TEST(priorityqueue, dequeue_n){
+    priorityqueue<string> t;
+    vector<string> out;
+
+    for (int i = 0; i < 100; i++)
+        t.enqueue(to_string(i), i / 4);
+
+    t.dequeue_n(10, back_inserter(out));
+    EXPECT_EQ(out.size(), 10);
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(out[i], to_string(i));
+    EXPECT_EQ(t.Size(), 90);
+    EXPECT_EQ(t.peek(), "10");
+
+    out.clear();
+    t.dequeue_n(0, back_inserter(out));
+    EXPECT_EQ(out.size(), 0);
+    t.dequeue_n(1000, back_inserter(out));
+    EXPECT_EQ(out.size(), 90);
+    EXPECT_EQ(out.front(), "10");
+    EXPECT_EQ(out.back(), "99");
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.dequeue(), "");
+
+    t.enqueue("again", 1);
+    EXPECT_EQ(t.dequeue(), "again");
+}
+
+/// @brief Test if dequeue_while stops at the first item the predicate rejects
+///        Additionally uses enqueue, dequeue, Size, Begin, Next
+TEST(priorityqueue, dequeue_while){
+    priorityqueue<int> t;
+    vector<int> expired;
+    int val, pri;
+
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, (i * 7919) % 1000);
+
+    t.dequeue_while([](const int&, const int& deadline) { return deadline < 250; }, back_inserter(expired));
+    EXPECT_EQ(expired.size(), 250);
+    EXPECT_EQ(t.Size(), 750);
+
+    t.begin();
+    t.next(val, pri);
+    EXPECT_EQ(pri, 250);
+
+    expired.clear();
+    t.dequeue_while([](const int&, const int&) { return false; }, back_inserter(expired));
+    EXPECT_EQ(expired.size(), 0);
+    EXPECT_EQ(t.Size(), 750);
+}
+
+/// @brief Test if enqueue_batch merges a large unsorted batch into an existing queue keeping duplicate order
+///        Additionally uses enqueue, dequeue, Size, copy constructor, equality operator
+TEST(priorityqueue, enqueue_batch_merge){
+    priorityqueue<string> t;
+    vector<pair<string, int>> batch;
+
+    t.enqueue("old 5", 5);
+    t.enqueue("old 1", 1);
+    for (int i = 0; i < 100; i++)
+        batch.push_back({"new " + to_string(i), (i * 37) % 10});
+
+    t.enqueue_batch(batch.begin(), batch.end());
+    EXPECT_EQ(t.Size(), 102);
+
+    priorityqueue<string> h(t);
+    EXPECT_EQ((h == t), true);
+
+    for (int p = 0; p < 10; p++){
+        if (p == 1){
+            EXPECT_EQ(t.dequeue(), "old 1");
+        }
+        if (p == 5){
+            EXPECT_EQ(t.dequeue(), "old 5");
+        }
+        for (int i = 0; i < 100; i++){
+            if ((i * 37) % 10 == p){
+                EXPECT_EQ(t.dequeue(), "new " + to_string(i));
+            }
+        }
+    }
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if a small enqueue_batch into a large queue inserts each priority list into the right place
+///        Additionally uses enqueue, dequeue, peek, Size
+TEST(priorityqueue, enqueue_batch_small){
+    priorityqueue<int> t;
+    vector<pair<int, int>> batch = {{-1, 500}, {-2, 500}, {-3, -5}, {-4, 1000}};
+
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, i);
+
+    t.enqueue_batch(batch.begin(), batch.end());
+    EXPECT_EQ(t.Size(), 1004);
+    EXPECT_EQ(t.peek(), -3);
+    EXPECT_EQ(t.dequeue(), -3);
+    for (int i = 0; i < 1000; i++){
+        EXPECT_EQ(t.dequeue(), i);
+        if (i == 500){
+            EXPECT_EQ(t.dequeue(), -1);
+            EXPECT_EQ(t.dequeue(), -2);
+        }
+    }
+    EXPECT_EQ(t.dequeue(), -4);
+    EXPECT_EQ(t.Size(), 0);
+
+    t.enqueue_batch(batch.begin(), batch.begin());
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if merge splices a large queue into another, keeping this queue's elements first among equal priorities
+///        Additionally uses enqueue, dequeue, toString, Size, operator==
+TEST(priorityqueue, merge_overlapping){
+    priorityqueue<string> a, b, expected;
+
+    for (int i = 0; i < 1000; i++){
+        a.enqueue("a" + to_string(i), i % 100);
+        b.enqueue("b" + to_string(i), i % 150);
+    }
+    for (int p = 0; p < 150; p++){
+        for (int i = p; i < 1000; i += 100){
+            if (p < 100)
+                expected.enqueue("a" + to_string(i), p);
+        }
+        for (int i = p; i < 1000; i += 150)
+            expected.enqueue("b" + to_string(i), p);
+    }
+
+    a.merge(std::move(b));
+    EXPECT_EQ(a.Size(), 2000);
+    EXPECT_EQ(b.Size(), 0);
+    EXPECT_EQ(a.toString(), expected.toString());
+
+    b.enqueue("reused", 7);
+    EXPECT_EQ(b.dequeue(), "reused");
+    while (expected.Size() > 0)
+        EXPECT_EQ(a.dequeue(), expected.dequeue());
+    EXPECT_EQ(a.Size(), 0);
+}
+
+/// @brief Test if merge handles empty queues, small queues, and a queue merged with itself
+///        Additionally uses enqueue, dequeue, peek, Size
+TEST(priorityqueue, merge_small_and_empty){
+    priorityqueue<int> a, b, empty;
+
+    a.merge(std::move(empty));
+    EXPECT_EQ(a.Size(), 0);
+
+    b.enqueue(5, 5);
+    b.enqueue(3, 3);
+    a.merge(std::move(b));
+    EXPECT_EQ(a.Size(), 2);
+    EXPECT_EQ(b.Size(), 0);
+    EXPECT_EQ(a.peek(), 3);
+
+    for (int i = 10; i < 1010; i++)
+        a.enqueue(i, i);
+    b.enqueue(-1, -1);
+    b.enqueue(50, 50);
+    a.merge(std::move(b));
+    a.merge(std::move(a));
+    EXPECT_EQ(a.Size(), 1004);
+    EXPECT_EQ(a.dequeue(), -1);
+    EXPECT_EQ(a.dequeue(), 3);
+    EXPECT_EQ(a.dequeue(), 5);
+    for (int i = 10; i < 1010; i++){
+        EXPECT_EQ(a.dequeue(), i);
+        if (i == 50){
+            EXPECT_EQ(a.dequeue(), 50);
+        }
+    }
+    EXPECT_EQ(a.Size(), 0);
+}
+
+/// @brief Test if the heap backend merges both small and large queues in priority and FIFO order
+///        Additionally uses enqueue, dequeue, Size
+TEST(heappriorityqueue, merge){
+    heappriorityqueue<int> a, b, c;
+
+    for (int i = 0; i < 100; i++){
+        a.enqueue(i, i % 10);
+        b.enqueue(100 + i, i % 10);
+    }
+    c.enqueue(200, 0);
+    a.merge(std::move(b));
+    a.merge(std::move(c));
+    EXPECT_EQ(a.Size(), 201);
+    EXPECT_EQ(b.Size(), 0);
+
+    for (int p = 0; p < 10; p++){
+        for (int i = p; i < 100; i += 10)
+            EXPECT_EQ(a.dequeue(), i);
+        for (int i = p; i < 100; i += 10)
+            EXPECT_EQ(a.dequeue(), 100 + i);
+        if (p == 0){
+            EXPECT_EQ(a.dequeue(), 200);
+        }
+    }
+    EXPECT_EQ(a.Size(), 0);
+}
+
+/// @brief Test if const_iterator walks duplicate lists forward and backward and works with standard algorithms and ranges
+///        Additionally uses enqueue, Size, cbegin, cend, rbegin, rend
+TEST(priorityqueue, const_iterator_bidirectional){
+    static_assert(std::ranges::bidirectional_range<priorityqueue<int>>);
+    static_assert(std::ranges::bidirectional_range<const priorityqueue<string>>);
+    priorityqueue<int> t;
+    vector<pair<int, int>> expected;
+
+    EXPECT_TRUE(t.cbegin() == t.cend());
+    for (int i = 0; i < 300; i++)
+        t.enqueue(i, (i * 7) % 40);
+    for (int p = 0; p < 40; p++){
+        for (int i = 0; i < 300; i++){
+            if ((i * 7) % 40 == p)
+                expected.push_back({p, i});
+        }
+    }
+
+    vector<pair<int, int>> forward;
+    for (auto it = t.cbegin(); it != t.cend(); ++it)
+        forward.push_back({it.priority(), *it});
+    EXPECT_EQ(forward, expected);
+
+    vector<pair<int, int>> backward;
+    for (auto it = t.cend(); it != t.cbegin(); ){
+        --it;
+        backward.push_back({it.priority(), *it});
+    }
+    reverse(backward.begin(), backward.end());
+    EXPECT_EQ(backward, expected);
+
+    vector<int> reversed(t.rbegin(), t.rend());
+    EXPECT_EQ((int)reversed.size(), t.Size());
+    EXPECT_EQ(reversed.front(), expected.back().second);
+    EXPECT_EQ(reversed.back(), expected.front().second);
+    EXPECT_EQ(distance(t.cbegin(), t.cend()), 300);
+    EXPECT_EQ(*std::ranges::find(t, 299), 299);
+}
+
+/// @brief Test if several iterators and the begin/next shim can traverse the same queue at once without interfering
+///        Additionally uses enqueue, begin, next, cbegin, cend
+TEST(priorityqueue, const_iterator_independent_readers){
+    priorityqueue<string> t;
+    for (int i = 0; i < 50; i++)
+        t.enqueue("v" + to_string(i), i % 5);
+    const priorityqueue<string>& shared = t;
+
+    vector<string> all(shared.begin(), shared.end());
+    string value;
+    int priority;
+    auto a = shared.begin();
+    auto b = shared.begin();
+    t.begin();
+    for (int i = 0; i < 25; i++){
+        EXPECT_EQ(*a, all[2 * i]);
+        EXPECT_EQ(*b, all[i]);
+        t.next(value, priority);
+        EXPECT_EQ(value, all[i]);
+        ++a;
+        ++a;
+        b++;
+    }
+    EXPECT_TRUE(a == shared.end());
+    EXPECT_EQ(*b, all[25]);
+
+    int words = 0;
+    for (const string& v : shared)
+        words += v[0] == 'v';
+    EXPECT_EQ(words, 50);
+}
+
+/// @brief Test if threads sharing a non-const queue can each run range-for over it, which calls the resetting begin
+///        Additionally uses enqueue, begin, end, thread
+TEST(priorityqueue, non_const_range_for_threads){
+    priorityqueue<int> t;
+    long long expected = 0;
+    for (int i = 0; i < 2000; i++){
+        t.enqueue(i, i % 37);
+        expected += i;
+    }
+
+    atomic<int> mismatches{0};
+    auto reader = [&]{
+        for (int round = 0; round < 50; round++){
+            long long sum = 0;
+            int previous = -1;
+            for (int v : t){
+                sum += v;
+                if (previous != -1 && v % 37 < previous % 37)
+                    mismatches++;
+                previous = v;
+            }
+            if (sum != expected)
+                mismatches++;
+        }
+    };
+    thread first(reader), second(reader);
+    first.join();
+    second.join();
+    EXPECT_EQ(mismatches, 0);
+}
+
+/// @brief Test if erase removes duplicates, list heads and tree nodes with two children through their handles
+///        Additionally uses enqueue, dequeue, peek, Size, toString
+TEST(priorityqueue, erase_handles){
+    priorityqueue<int> t;
+    vector<priorityqueue<int>::handle> handles;
+
+    for (int i = 0; i < 60; i++)
+        handles.push_back(t.enqueue(i, i % 20));
+    EXPECT_EQ(handles[25].value(), 25);
+    EXPECT_EQ(handles[25].priority(), 5);
+
+    t.erase(handles[45]); //Tail of the list for priority 5
+    t.erase(handles[5]); //Head of the list for priority 5
+    t.erase(handles[10]); //Head of the list for priority 10, then its duplicates
+    t.erase(handles[30]);
+    t.erase(handles[50]);
+    t.erase(handles[0]); //The cached minimum
+    EXPECT_EQ(t.Size(), 54);
+    EXPECT_EQ(t.peek(), 20);
+
+    for (int p = 0; p < 20; p++){
+        for (int i = p; i < 60; i += 20){
+            if (i != 45 && i != 5 && i % 20 != 10 && i != 0){
+                EXPECT_EQ(t.dequeue(), i);
+            }
+        }
+    }
+    EXPECT_EQ(t.Size(), 0);
+
+    for (int i = 0; i < 1000; i++)
+        handles[i % 60] = t.enqueue(i, i);
+    for (int i = 0; i < 60; i++)
+        t.erase(handles[i]);
+    EXPECT_EQ(t.Size(), 940);
+    for (int i = 0; i < 940; i++)
+        EXPECT_EQ(t.dequeue(), i);
+}
+
+/// @brief Test if update_priority moves elements between duplicate lists and keeps handles and FIFO order
+///        Additionally uses enqueue, emplace, dequeue, peek, peekPriority, Size
+TEST(priorityqueue, update_priority_handles){
+    priorityqueue<string> t;
+
+    auto a = t.enqueue("a", 10);
+    auto b = t.enqueue("b", 10);
+    auto c = t.emplace(20, "c");
+    t.enqueue("d", 5);
+
+    t.update_priority(c, 1);
+    EXPECT_EQ(t.peek(), "c");
+    EXPECT_EQ(c.priority(), 1);
+
+    t.update_priority(a, 5); //Head of a list joins the end of another list
+    t.update_priority(b, 10); //Equivalent priority keeps its place
+    t.update_priority(c, 5);
+    EXPECT_EQ(t.Size(), 4);
+    EXPECT_EQ(t.peekPriority(), 5);
+    EXPECT_EQ(t.dequeue(), "d");
+    EXPECT_EQ(t.dequeue(), "a");
+    EXPECT_EQ(t.dequeue(), "c");
+
+    t.update_priority(b, -3);
+    auto e = t.enqueue("e", 0);
+    EXPECT_EQ(t.dequeue(), "b");
+    t.erase(e);
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if lower_bound, upper_bound and count_range find and count priority intervals including duplicates
+///        Additionally uses enqueue, dequeue, Size
+TEST(priorityqueue, count_range_bounds){
+    priorityqueue<int> t;
+
+    EXPECT_EQ(t.count_range(0, 100), 0);
+    EXPECT_TRUE(t.lower_bound(5) == t.cend());
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, (i % 100) * 2); //Even priorities 0 to 198, 10 elements each
+
+    EXPECT_EQ(t.count_range(0, 198), 1000);
+    EXPECT_EQ(t.count_range(10, 20), 60);
+    EXPECT_EQ(t.count_range(11, 19), 40);
+    EXPECT_EQ(t.count_range(-50, -1), 0);
+    EXPECT_EQ(t.count_range(20, 10), 0);
+    EXPECT_EQ(t.count_range(197, 500), 10);
+
+    auto it = t.lower_bound(11);
+    EXPECT_EQ(it.priority(), 12);
+    EXPECT_EQ(*it, 6);
+    EXPECT_EQ(t.lower_bound(12).priority(), 12);
+    EXPECT_EQ(t.upper_bound(12).priority(), 14);
+    EXPECT_TRUE(t.upper_bound(198) == t.cend());
+    EXPECT_EQ(distance(t.lower_bound(10), t.upper_bound(20)), 60);
+
+    for (int i = 0; i < 100; i++)
+        t.dequeue();
+    EXPECT_EQ(t.count_range(0, 18), 0);
+    EXPECT_EQ(t.count_range(20, 20), 10);
+}
+
+/// @brief Test if erase_range and extract_range cut out whole intervals and leave the rest of the queue in order
+///        Additionally uses enqueue, dequeue, peek, Size, count_range
+TEST(priorityqueue, erase_extract_range){
+    priorityqueue<string> t;
+
+    for (int i = 0; i < 500; i++)
+        t.enqueue(to_string(i), i % 50);
+
+    vector<string> expired;
+    t.extract_range(-100, 9, back_inserter(expired));
+    EXPECT_EQ(expired.size(), 100u);
+    EXPECT_EQ(expired[0], "0");
+    EXPECT_EQ(expired[1], "50");
+    EXPECT_EQ(expired.back(), "459");
+    EXPECT_EQ(t.Size(), 400);
+    EXPECT_EQ(t.peek(), "10");
+
+    EXPECT_EQ(t.erase_range(20, 29), 100);
+    EXPECT_EQ(t.erase_range(25, 29), 0);
+    EXPECT_EQ(t.erase_range(40, 39), 0);
+    EXPECT_EQ(t.Size(), 300);
+    EXPECT_EQ(t.count_range(0, 100), 300);
+
+    for (int p = 10; p < 50; p++){
+        if (p >= 20 && p < 30)
+            continue;
+        for (int i = p; i < 500; i += 50)
+            EXPECT_EQ(t.dequeue(), to_string(i));
+    }
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.erase_range(0, 100), 0);
+}
+
+/// @brief Test if nth finds every position, including positions inside long duplicate lists, and rank counts before a priority
+///        Additionally uses enqueue, dequeue, Size, cbegin, cend
+TEST(priorityqueue, nth_rank){
+    priorityqueue<int> t;
+
+    EXPECT_TRUE(t.nth(0) == t.cend());
+    EXPECT_EQ(t.rank(5), 0);
+    for (int i = 0; i < 600; i++)
+        t.enqueue(i, i < 300 ? i : 1000 + i % 3); //300 unique priorities, then 3 lists of 100
+
+    int k = 0;
+    for (auto it = t.cbegin(); it != t.cend(); ++it, ++k){
+        auto found = t.nth(k);
+        EXPECT_TRUE(found == it);
+        EXPECT_EQ(found.priority(), it.priority());
+    }
+    EXPECT_TRUE(t.nth(600) == t.cend());
+    EXPECT_TRUE(t.nth(-1) == t.cend());
+    EXPECT_EQ(*t.nth(399), 597);
+    EXPECT_EQ(*t.nth(400), 301);
+
+    EXPECT_EQ(t.rank(0), 0);
+    EXPECT_EQ(t.rank(150), 150);
+    EXPECT_EQ(t.rank(500), 300);
+    EXPECT_EQ(t.rank(1001), 400);
+    EXPECT_EQ(t.rank(1003), 600);
+
+    for (int i = 0; i < 350; i++)
+        t.dequeue();
+    EXPECT_EQ(t.nth(0).priority(), 1000);
+    EXPECT_EQ(*t.nth(49), 597);
+    EXPECT_EQ(t.rank(1001), 50);
+}
+
+/// @brief Test if a bounded queue keeps the best k elements, evicting the worst and rejecting worse elements
+///        Additionally uses enqueue, emplace, dequeue, peek, Size, capacity, toString
+TEST(priorityqueue, bounded_top_k){
+    priorityqueue<string> t;
+    EXPECT_EQ(t.capacity(), 0);
+
+    t.set_capacity(3);
+    EXPECT_TRUE(bool(t.enqueue("a", 50)));
+    t.enqueue("b", 40);
+    t.enqueue("c", 40);
+    EXPECT_EQ(t.Size(), 3);
+
+    EXPECT_FALSE(bool(t.enqueue("d", 50))); //Equal to the worst is rejected
+    EXPECT_FALSE(bool(t.emplace(60, "e")));
+    EXPECT_TRUE(bool(t.enqueue("f", 45))); //Evicts "a"
+    EXPECT_EQ(t.toString(), "40 value: b\n40 value: c\n45 value: f\n");
+
+    EXPECT_TRUE(bool(t.enqueue("g", 10))); //Evicts "f"
+    EXPECT_TRUE(bool(t.enqueue("h", 10))); //Evicts "c", the tail of the list for 40
+    EXPECT_EQ(t.Size(), 3);
+    EXPECT_EQ(t.dequeue(), "g");
+    EXPECT_EQ(t.dequeue(), "h");
+    EXPECT_EQ(t.dequeue(), "b");
+    EXPECT_EQ(t.Size(), 0);
+
+    t.set_capacity(0);
+    for (int i = 0; i < 100; i++)
+        t.enqueue(to_string(i), i);
+    t.set_capacity(10);
+    EXPECT_EQ(t.Size(), 10);
+    EXPECT_FALSE(bool(t.enqueue("x", 10)));
+    EXPECT_TRUE(bool(t.enqueue("y", 8)));
+    EXPECT_EQ(t.peek(), "0");
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(t.dequeue(), i < 9 ? to_string(i) : "y");
+}
+
+/// @brief Test if a bounded queue trims batches, merges and assignments and carries its bound through copies
+///        Additionally uses enqueue, enqueue_batch, merge, assign, dequeue, Size, capacity
+TEST(priorityqueue, bounded_bulk){
+    priorityqueue<int> t, other;
+    vector<pair<int, int>> batch;
+
+    t.set_capacity(5);
+    for (int i = 0; i < 20; i++)
+        batch.push_back({i, 20 - i});
+    t.enqueue_batch(batch.begin(), batch.end());
+    EXPECT_EQ(t.Size(), 5);
+    EXPECT_EQ(t.peek(), 19);
+
+    for (int i = 0; i < 10; i++)
+        other.enqueue(100 + i, i % 2);
+    t.merge(std::move(other));
+    EXPECT_EQ(t.Size(), 5);
+
+    priorityqueue<int> copy(t);
+    EXPECT_EQ(copy.capacity(), 5);
+    EXPECT_EQ(copy.Size(), 5);
+    copy.assign(batch.begin(), batch.end());
+    EXPECT_EQ(copy.Size(), 5);
+    EXPECT_EQ(copy.dequeue(), 19);
+
+    int expected[] = {100, 102, 104, 106, 108};
+    for (int value : expected)
+        EXPECT_EQ(t.dequeue(), value);
+    EXPECT_EQ(t.Size(), 0);
+}
+
+/// @brief Test if a full bounded queue can take a copy of the element it is about to evict
+///        Additionally uses enqueue, emplace, set_capacity, dequeue, Size
+TEST(priorityqueue, bounded_copy_of_evicted){
+    priorityqueue<string> t;
+    t.set_capacity(2);
+    t.enqueue("a", 1);
+
+    auto worst = t.enqueue(string(100, 'b'), 5);
+    auto copy = t.enqueue(worst.value(), 3);
+    EXPECT_TRUE(copy);
+    EXPECT_EQ(copy.value(), string(100, 'b'));
+
+    auto emplaced = t.emplace(2, copy.value());
+    EXPECT_TRUE(emplaced);
+    EXPECT_EQ(emplaced.value(), string(100, 'b'));
+    EXPECT_EQ(t.Size(), 2);
+    EXPECT_EQ(t.dequeue(), "a");
+    EXPECT_EQ(t.dequeue(), string(100, 'b'));
+}
+
+// Queue instantiated with Stats so the hot path counters are counted
+using countingqueue = priorityqueue<int, int, less<int>, true>;
+
+/// @brief Test if stats reports the shape of the tree and counts the hot path steps
+///        Additionally uses enqueue, erase, dequeue, Size
+TEST(priorityqueue, stats){
+    countingqueue t;
+    priorityqueuestats snapshot = t.stats();
+    EXPECT_EQ(snapshot.size, 0);
+    EXPECT_EQ(snapshot.uniqueNodes, 0);
+    EXPECT_EQ(snapshot.height, 0);
+    EXPECT_EQ(snapshot.longestList, 0);
+    EXPECT_EQ(snapshot.insertions, 0);
+
+    countingqueue::handle root;
+    for (int i = 0; i < 15; i++){
+        if (i == 7)
+            root = t.enqueue(i, i);
+        else
+            t.enqueue(i, i);
+    }
+    for (int i = 0; i < 5; i++)
+        t.enqueue(100 + i, 3);
+    snapshot = t.stats();
+    EXPECT_EQ(snapshot.size, 20);
+    EXPECT_EQ(snapshot.uniqueNodes, 15);
+    EXPECT_EQ(snapshot.height, 4);
+    EXPECT_EQ(snapshot.longestList, 6);
+    EXPECT_GE(snapshot.bytesAllocated, 20 * sizeof(int));
+    EXPECT_EQ(snapshot.insertions, 20);
+    EXPECT_GE(snapshot.descentSteps, 14 + 5 * 2);
+
+    //Erasing the root takes its successor from the leftmost node of the right subtree
+    long long spine = snapshot.spineSteps;
+    t.erase(root);
+    EXPECT_GE(t.stats().spineSteps, spine + 2);
+
+    while (t.Size() > 0)
+        t.dequeue();
+    snapshot = t.stats();
+    EXPECT_EQ(snapshot.size, 0);
+    EXPECT_EQ(snapshot.uniqueNodes, 0);
+    EXPECT_EQ(snapshot.longestList, 0);
+    EXPECT_EQ(snapshot.insertions, 20);
+}
+
+/// @brief Test if stats counts the duplicate list nodes stepped over when a handle inside a list is erased
+///        Additionally uses enqueue, erase, Size
+TEST(priorityqueue, stats_list_steps){
+    countingqueue t;
+    vector<countingqueue::handle> handles;
+    for (int i = 0; i < 10; i++)
+        handles.push_back(t.enqueue(i, 1));
+    EXPECT_EQ(t.stats().longestList, 10);
+    long long before = t.stats().listSteps;
+
+    t.erase(handles[0]);
+    EXPECT_EQ(t.Size(), 9);
+    EXPECT_EQ(t.stats().longestList, 9);
+    EXPECT_GE(t.stats().listSteps, before + 1);
+}
+
+/// @brief Test if stats reports the shape of the tree while the hot path counters are compiled out by default
+///        Additionally uses enqueue, dequeue
+TEST(priorityqueue, stats_shape){
+    priorityqueue<int> t;
+    for (int i = 0; i < 15; i++)
+        t.enqueue(i, i);
+    for (int i = 0; i < 5; i++)
+        t.enqueue(100 + i, 3);
+    t.dequeue();
+
+    priorityqueuestats snapshot = t.stats();
+    EXPECT_EQ(snapshot.size, 19);
+    EXPECT_EQ(snapshot.uniqueNodes, 14);
+    EXPECT_EQ(snapshot.height, 4);
+    EXPECT_EQ(snapshot.longestList, 6);
+    EXPECT_GE(snapshot.bytesAllocated, 19 * sizeof(int));
+    EXPECT_EQ(snapshot.insertions, 0);
+    EXPECT_EQ(snapshot.descentSteps, 0);
+    EXPECT_EQ(snapshot.listSteps, 0);
+    EXPECT_EQ(snapshot.spineSteps, 0);
+}
+
+/// @brief Test if save and load restore the queue in dequeue order, including values with whitespace
+///        Additionally uses enqueue, dequeue, Size, toString, stats
+TEST(priorityqueue, save_load){
+    priorityqueue<string> t, restored;
+    stringstream snapshot;
+
+    t.enqueue("two words", 2);
+    t.enqueue("", 1);
+    t.enqueue("tab\tand\nnewline", 2);
+    t.enqueue("last", 9);
+    t.enqueue("first", -4);
+    EXPECT_TRUE(t.save(snapshot));
+
+    restored.enqueue("replaced", 5);
+    EXPECT_TRUE(restored.load(snapshot));
+    EXPECT_EQ(restored.Size(), 5);
+    EXPECT_EQ(restored.toString(), t.toString());
+    EXPECT_EQ(restored.stats().uniqueNodes, 4);
+    EXPECT_EQ(restored.stats().longestList, 2);
+    string expected[] = {"first", "", "two words", "tab\tand\nnewline", "last"};
+    for (const string& value : expected)
+        EXPECT_EQ(restored.dequeue(), value);
+
+    priorityqueue<string> empty;
+    stringstream emptySnapshot;
+    EXPECT_TRUE(priorityqueue<string>().save(emptySnapshot));
+    empty.enqueue("gone", 1);
+    EXPECT_TRUE(empty.load(emptySnapshot));
+    EXPECT_EQ(empty.Size(), 0);
+}
+
+/// @brief Test if load rejects a damaged or truncated snapshot and leaves the queue unchanged
+///        Additionally uses enqueue, save, Size, peek
+TEST(priorityqueue, load_rejects){
+    priorityqueue<int> t, target;
+    stringstream good;
+
+    for (int i = 0; i < 100; i++)
+        t.enqueue(i, i % 7);
+    t.save(good);
+    string bytes = good.str();
+    target.enqueue(42, 0);
+
+    string flipped = bytes;
+    flipped[flipped.size() - 3] ^= 1;
+    stringstream damaged(flipped), truncated(bytes.substr(0, bytes.size() - 1)), noMagic("QPSB" + bytes.substr(4));
+    EXPECT_FALSE(target.load(damaged));
+    EXPECT_FALSE(target.load(truncated));
+    EXPECT_FALSE(target.load(noMagic));
+    EXPECT_EQ(target.Size(), 1);
+    EXPECT_EQ(target.peek(), 42);
+
+    stringstream intact(bytes);
+    EXPECT_TRUE(target.load(intact));
+    EXPECT_TRUE(target == t);
+}
+
+/// @brief A value type that is not trivially copyable, saved through its own priorityqueueserializer
+struct job {
+    string name;
+    vector<int> steps;
+};
+
+template<>
+struct priorityqueueserializer<job> {
+    static void write(string& out, const job& field){
+        priorityqueueserializer<string>::write(out, field.name);
+        priorityqueueserializer<uint64_t>::write(out, field.steps.size());
+        for (int step : field.steps)
+            priorityqueueserializer<int>::write(out, step);
+    }
+
+    static bool read(string_view& in, job& field){
+        uint64_t count;
+        if (!priorityqueueserializer<string>::read(in, field.name) || !priorityqueueserializer<uint64_t>::read(in, count))
+            return false;
+        field.steps.resize(count);
+        for (int& step : field.steps)
+            if (!priorityqueueserializer<int>::read(in, step))
+                return false;
+        return true;
+    }
+};
+
+/// @brief Test if save and load use a user serializer and a comparator, and a bounded queue trims what it loads
+///        Additionally uses enqueue, dequeue, set_capacity, Size
+TEST(priorityqueue, save_load_serializer){
+    priorityqueue<job, double, greater<double>> t, restored;
+    stringstream snapshot;
+
+    t.enqueue({"build", {1, 2, 3}}, 0.5);
+    t.enqueue({"test", {}}, 2.25);
+    t.enqueue({"ship", {7}}, 0.5);
+    EXPECT_TRUE(t.save(snapshot));
+    EXPECT_TRUE(restored.load(snapshot));
+    EXPECT_EQ(restored.Size(), 3);
+    EXPECT_EQ(restored.dequeue().name, "test");
+    job next = restored.dequeue();
+    EXPECT_EQ(next.name, "build");
+    EXPECT_EQ(next.steps, vector<int>({1, 2, 3}));
+    EXPECT_EQ(restored.dequeue().steps, vector<int>({7}));
+
+    priorityqueue<int> ints, bounded;
+    stringstream intSnapshot;
+    for (int i = 0; i < 50; i++)
+        ints.enqueue(i, 50 - i);
+    ints.save(intSnapshot);
+    bounded.set_capacity(3);
+    EXPECT_TRUE(bounded.load(intSnapshot));
+    EXPECT_EQ(bounded.Size(), 3);
+    EXPECT_EQ(bounded.dequeue(), 49);
+}
+
+/// @brief Test if a mapped queue keeps its elements, their order and its sequence numbers across close and open
+///        Additionally uses enqueue, dequeue, peek, peekPriority, Size, sync, clear
+TEST(mappedpriorityqueue, reopen){
+    string path = testing::TempDir() + "mappedpriorityqueue_reopen.bin";
+    remove(path.c_str());
+    {
+        mappedpriorityqueue<double> t;
+        EXPECT_FALSE(t.is_open());
+        EXPECT_FALSE(t.enqueue(1.5, 1));
+        ASSERT_TRUE(t.open(path));
+        for (int i = 0; i < 5000; i++)
+            EXPECT_TRUE(t.enqueue(i + 0.5, i % 10));
+        EXPECT_TRUE(t.sync());
+        EXPECT_EQ(t.dequeue(), 0.5);
+    }
+
+    mappedpriorityqueue<double> t;
+    ASSERT_TRUE(t.open(path));
+    EXPECT_EQ(t.Size(), 4999);
+    EXPECT_EQ(t.peek(), 10.5);
+    EXPECT_EQ(t.peekPriority(), 0);
+    t.enqueue(-1, 0);
+    for (int i = 1; i < 500; i++)
+        EXPECT_EQ(t.dequeue(), i * 10 + 0.5);
+    EXPECT_EQ(t.dequeue(), -1);
+    EXPECT_EQ(t.dequeue(), 1.5);
+
+    t.clear();
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.dequeue(), 0);
+    t.close();
+    EXPECT_FALSE(t.is_open());
+    EXPECT_EQ(t.Size(), 0);
+    remove(path.c_str());
+}
+
+/// @brief Test if a mapped queue survives a process that ends without sync or close, and rejects foreign files
+///        Additionally uses enqueue, dequeue, Size
+TEST(mappedpriorityqueue, crash_and_reject){
+    string path = testing::TempDir() + "mappedpriorityqueue_crash.bin";
+    remove(path.c_str());
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0){ //Fill the queue and end without running destructors
+        mappedpriorityqueue<int, int, greater<int>> t;
+        if (!t.open(path))
+            _exit(1);
+        for (int i = 0; i < 3000; i++)
+            t.enqueue(i, i % 100);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    mappedpriorityqueue<int, int, greater<int>> t;
+    ASSERT_TRUE(t.open(path));
+    EXPECT_EQ(t.Size(), 3000);
+    for (int i = 99; i < 3000; i += 100)
+        EXPECT_EQ(t.dequeue(), i);
+    t.close();
+
+    struct wide { int data[8]; };
+    mappedpriorityqueue<wide> wrongLayout;
+    EXPECT_FALSE(wrongLayout.open(path));
+    string textPath = testing::TempDir() + "mappedpriorityqueue_text.bin";
+    FILE* text = fopen(textPath.c_str(), "w");
+    fputs("1 value: not a mapped queue\n", text);
+    fclose(text);
+    EXPECT_FALSE(wrongLayout.open(textPath));
+    EXPECT_FALSE(wrongLayout.is_open());
+    remove(textPath.c_str());
+    remove(path.c_str());
+}
+
+/// @brief Test if a compact queue dequeues by priority, keeps duplicates in enqueue order and traverses inorder
+///        Additionally uses enqueue, dequeue, peek, peekPriority, begin, next, toString, Size
+TEST(compactpriorityqueue, order){
+    compactpriorityqueue<string> t;
+    priorityqueue<string> reference;
+    string value;
+    int priority;
+
+    EXPECT_EQ(t.dequeue(), "");
+    EXPECT_EQ(t.peekPriority(), 0);
+    for (int i = 0; i < 200; i++){
+        t.enqueue(to_string(i), (i * 37) % 50);
+        reference.enqueue(to_string(i), (i * 37) % 50);
+    }
+    EXPECT_EQ(t.Size(), 200);
+    EXPECT_EQ(t.toString(), reference.toString());
+
+    t.begin();
+    int visited = 0;
+    bool more = true;
+    while (more){
+        more = t.next(value, priority);
+        EXPECT_EQ(priority, reference.peekPriority());
+        EXPECT_EQ(value, reference.dequeue());
+        visited++;
+    }
+    EXPECT_EQ(visited, 200);
+
+    EXPECT_EQ(t.peek(), "0");
+    for (int p = 0; p < 50; p++){
+        for (int i = 0; i < 200; i++){
+            if ((i * 37) % 50 == p){
+                EXPECT_EQ(t.peekPriority(), p);
+                EXPECT_EQ(t.dequeue(), to_string(i));
+            }
+        }
+    }
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.toString(), "");
+}
+
+/// @brief Test if copies of a compact queue compare equal and stay independent, and a moved from queue is empty
+///        Additionally uses enqueue, dequeue, Size, clear, greater
+TEST(compactpriorityqueue, copy_move){
+    compactpriorityqueue<int, int, greater<int>> t;
+    for (int i = 0; i < 1000; i++)
+        t.enqueue(i, i % 10);
+
+    compactpriorityqueue<int, int, greater<int>> copy(t);
+    EXPECT_TRUE(copy == t);
+    EXPECT_EQ(copy.dequeue(), 9);
+    EXPECT_FALSE(copy == t);
+    EXPECT_EQ(t.Size(), 1000);
+
+    compactpriorityqueue<int, int, greater<int>> moved(std::move(copy));
+    EXPECT_EQ(moved.Size(), 999);
+    EXPECT_EQ(copy.Size(), 0);
+    EXPECT_EQ(copy.dequeue(), 0);
+    EXPECT_TRUE(copy.enqueue(5, 5));
+    EXPECT_EQ(copy.dequeue(), 5);
+    EXPECT_EQ(moved.dequeue(), 19);
+
+    t.clear();
+    EXPECT_EQ(t.Size(), 0);
+    EXPECT_EQ(t.bytes_allocated(), 0);
+}
+
+/// @brief Test if a compact queue of 8-byte values needs less than half the node storage of priorityqueue
+///        Additionally uses reserve, enqueue, dequeue, stats
+TEST(compactpriorityqueue, memory){
+    const int n = 100000;
+    compactpriorityqueue<unsigned long long> compact;
+    priorityqueue<unsigned long long> tree;
+
+    compact.reserve(n);
+    tree.reserve(n);
+    for (int i = 0; i < n; i++){
+        compact.enqueue(i, i % 5000);
+        tree.enqueue(i, i % 5000);
+    }
+    EXPECT_LT(compact.bytes_allocated() * 2, tree.stats().bytesAllocated);
+
+    //Dequeued nodes are reused instead of growing the storage
+    size_t reserved = compact.bytes_allocated();
+    for (int round = 0; round < 3; round++){
+        for (int i = 0; i < n / 2; i++)
+            compact.dequeue();
+        for (int i = 0; i < n / 2; i++)
+            compact.enqueue(i, i);
+    }
+    EXPECT_EQ(compact.bytes_allocated(), reserved);
+    EXPECT_EQ(compact.Size(), n);
+}